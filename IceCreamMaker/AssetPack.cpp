@@ -0,0 +1,293 @@
+#include "AssetPack.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Constants
+const char* const ASSET_PACK_PATH = "assets.pack";
+const size_t ASSET_PACK_ALIGNMENT = 64; // A cache line; also enough for any SIMD load
+static const char PACK_MAGIC[8] = { 'I', 'C', 'E', 'P', 'A', 'C', 'K', '1' };
+static const uint32_t PACK_VERSION = 1;
+
+struct PackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint64_t fileSize;
+};
+
+struct PackEntry {
+    uint64_t offset;     // From the start of the pack
+    uint64_t size;
+    uint32_t nameOffset; // Into the name table, which follows the index
+    uint32_t nameLength;
+};
+
+static const unsigned char* packData = nullptr;
+static size_t packSize = 0;
+static const PackEntry* packIndex = nullptr;
+static const char* packNames = nullptr;
+static uint32_t packEntryCount = 0;
+static time_t packTime = 0;
+#ifdef _WIN32
+static HANDLE packFile = INVALID_HANDLE_VALUE;
+static HANDLE packMapping = NULL;
+#endif
+
+static bool fileExists(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+static std::string executableDirectory() {
+#ifdef _WIN32
+    char path[MAX_PATH];
+    DWORD length = GetModuleFileNameA(NULL, path, MAX_PATH);
+    if (length == 0 || length == MAX_PATH) return std::string();
+#else
+    char path[4096];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length <= 0) return std::string();
+#endif
+    std::string executable(path, (size_t)length);
+    size_t slash = executable.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : executable.substr(0, slash + 1);
+}
+
+std::string resolveAssetPath(const char* path) {
+    if (fileExists(path)) return path;
+    bool absolute = path[0] == '/' || path[0] == '\\' || (path[0] != '\0' && path[1] == ':');
+    if (!absolute) {
+        // Build outputs sit below the asset directory (build/, x64/Release/), so look up from there too
+        std::string directory = executableDirectory();
+        for (int up = 0; up <= 2 && !directory.empty(); up++, directory += "../") {
+            std::string candidate = directory + path;
+            if (fileExists(candidate)) return candidate;
+        }
+    }
+    return path;
+}
+
+static std::string normalizeName(const std::string& name) {
+    std::string normalized = name;
+    std::replace(normalized.begin(), normalized.end(), '\\', '/');
+    while (normalized.compare(0, 2, "./") == 0) normalized.erase(0, 2);
+    return normalized;
+}
+
+static bool mapFile(const std::string& path) {
+#ifdef _WIN32
+    packFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (packFile == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(packFile, &size) || size.QuadPart == 0) {
+        closeAssetPack();
+        return false;
+    }
+    packMapping = CreateFileMappingA(packFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (packMapping == NULL) {
+        closeAssetPack();
+        return false;
+    }
+    packData = (const unsigned char*)MapViewOfFile(packMapping, FILE_MAP_READ, 0, 0, 0);
+    packSize = (size_t)size.QuadPart;
+    if (!packData) {
+        closeAssetPack();
+        return false;
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file alive
+    if (mapping == MAP_FAILED) return false;
+    // Start reading the whole pack in the background; startup touches nearly all of it
+    madvise(mapping, (size_t)info.st_size, MADV_WILLNEED);
+    packData = (const unsigned char*)mapping;
+    packSize = (size_t)info.st_size;
+#endif
+    return true;
+}
+
+bool openAssetPack(const char* path) {
+    closeAssetPack();
+    std::string resolved = resolveAssetPath(path);
+    struct stat info;
+    if (stat(resolved.c_str(), &info) != 0 || !mapFile(resolved)) return false;
+    packTime = info.st_mtime;
+
+    PackHeader header;
+    bool valid = packSize >= sizeof(header);
+    if (valid) {
+        memcpy(&header, packData, sizeof(header));
+        valid = memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0 && header.version == PACK_VERSION &&
+            header.fileSize == packSize && sizeof(header) + (uint64_t)header.entryCount * sizeof(PackEntry) <= packSize;
+    }
+    if (valid) {
+        packIndex = (const PackEntry*)(packData + sizeof(header));
+        packNames = (const char*)(packIndex + header.entryCount);
+        packEntryCount = header.entryCount;
+        for (uint32_t i = 0; i < packEntryCount && valid; i++) {
+            const PackEntry& entry = packIndex[i];
+            valid = entry.offset + entry.size <= packSize &&
+                (const unsigned char*)packNames + entry.nameOffset + entry.nameLength <= packData + packSize;
+        }
+    }
+    if (!valid) {
+        std::cout << resolved << " is not a valid asset pack" << std::endl;
+        closeAssetPack();
+        return false;
+    }
+    std::cout << "Asset pack: " << resolved << ", " << packEntryCount << " assets, "
+        << packSize / (1024 * 1024) << " MiB mapped" << std::endl;
+    return true;
+}
+
+void closeAssetPack() {
+#ifdef _WIN32
+    if (packData) UnmapViewOfFile(packData);
+    if (packMapping) CloseHandle(packMapping);
+    if (packFile != INVALID_HANDLE_VALUE) CloseHandle(packFile);
+    packMapping = NULL;
+    packFile = INVALID_HANDLE_VALUE;
+#else
+    if (packData) munmap((void*)packData, packSize);
+#endif
+    packData = nullptr;
+    packSize = 0;
+    packIndex = nullptr;
+    packNames = nullptr;
+    packEntryCount = 0;
+}
+
+bool isAssetPackOpen() {
+    return packData != nullptr;
+}
+
+// Binary search; the packer sorts the index by name
+static const PackEntry* findPackEntry(const std::string& name) {
+    const PackEntry* first = packIndex;
+    const PackEntry* last = packIndex + packEntryCount;
+    const PackEntry* found = std::lower_bound(first, last, name, [](const PackEntry& entry, const std::string& key) {
+        return std::string(packNames + entry.nameOffset, entry.nameLength) < key;
+    });
+    if (found == last || std::string(packNames + found->nameOffset, found->nameLength) != name) return nullptr;
+    return found;
+}
+
+bool loadAsset(const char* name, AssetSpan& span, std::vector<unsigned char>& storage) {
+    if (packData) {
+        const PackEntry* entry = findPackEntry(normalizeName(name));
+        if (entry) {
+            span.data = packData + entry->offset;
+            span.size = (size_t)entry->size;
+            return true;
+        }
+    }
+
+    std::ifstream file(resolveAssetPath(name), std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    storage.resize((size_t)file.tellg());
+    file.seekg(0);
+    file.read((char*)storage.data(), storage.size());
+    if (!file) return false;
+    span.data = storage.data();
+    span.size = storage.size();
+    return true;
+}
+
+bool assetModificationTime(const char* name, time_t& time) {
+    if (packData && findPackEntry(normalizeName(name))) {
+        time = packTime;
+        return true;
+    }
+    struct stat info;
+    if (stat(resolveAssetPath(name).c_str(), &info) != 0) return false;
+    time = info.st_mtime;
+    return true;
+}
+
+bool writeAssetPack(const char* outPath, const std::vector<std::string>& files) {
+    struct PendingFile {
+        std::string name;
+        std::vector<unsigned char> data;
+    };
+    std::vector<PendingFile> pending;
+    for (const std::string& path : files) {
+        PendingFile file;
+        file.name = normalizeName(path);
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) {
+            std::cout << "Failed to read " << path << std::endl;
+            return false;
+        }
+        file.data.resize((size_t)in.tellg());
+        in.seekg(0);
+        in.read((char*)file.data.data(), file.data.size());
+        pending.push_back(std::move(file));
+    }
+    std::sort(pending.begin(), pending.end(), [](const PendingFile& a, const PendingFile& b) { return a.name < b.name; });
+    for (size_t i = 1; i < pending.size(); i++) {
+        if (pending[i].name == pending[i - 1].name) {
+            std::cout << "Asset listed twice: " << pending[i].name << std::endl;
+            return false;
+        }
+    }
+
+    std::vector<PackEntry> index(pending.size());
+    std::string names;
+    for (size_t i = 0; i < pending.size(); i++) {
+        index[i].nameOffset = (uint32_t)names.size();
+        index[i].nameLength = (uint32_t)pending[i].name.size();
+        names += pending[i].name;
+    }
+    uint64_t offset = sizeof(PackHeader) + index.size() * sizeof(PackEntry) + names.size();
+    for (size_t i = 0; i < pending.size(); i++) {
+        offset = (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+        index[i].offset = offset;
+        index[i].size = pending[i].data.size();
+        offset += pending[i].data.size();
+    }
+
+    PackHeader header;
+    memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version = PACK_VERSION;
+    header.entryCount = (uint32_t)pending.size();
+    header.fileSize = offset;
+
+    std::ofstream out(outPath, std::ios::binary);
+    if (!out) {
+        std::cout << "Failed to write " << outPath << std::endl;
+        return false;
+    }
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)index.data(), index.size() * sizeof(PackEntry));
+    out.write(names.data(), names.size());
+    uint64_t written = sizeof(header) + index.size() * sizeof(PackEntry) + names.size();
+    std::vector<char> padding(ASSET_PACK_ALIGNMENT, 0);
+    for (size_t i = 0; i < pending.size(); i++) {
+        out.write(padding.data(), (std::streamsize)(index[i].offset - written));
+        out.write((const char*)pending[i].data.data(), pending[i].data.size());
+        written = index[i].offset + pending[i].data.size();
+    }
+    if (!out) return false;
+    std::cout << "Asset pack: " << outPath << ", " << pending.size() << " assets, " << written / 1024 << " KiB" << std::endl;
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+// Every asset the game loads (res/ and the shader sources) in one file that is memory-mapped
+// at startup. Loaders get spans straight into the mapping, so nothing is opened or copied per
+// asset. Anything missing from the pack is read from disk instead, so loose files keep working.
+//
+// Pack layout (little-endian): header, index sorted by name, name table, then the data of
+// every entry starting on an ASSET_PACK_ALIGNMENT boundary.
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+struct AssetSpan {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+};
+
+// Constants
+extern const char* const ASSET_PACK_PATH;
+extern const size_t ASSET_PACK_ALIGNMENT;
+
+// Function declarations
+// Maps the pack; relative paths are tried from the working directory, then from the executable's
+// directory and the two above it
+bool openAssetPack(const char* path);
+void closeAssetPack();
+bool isAssetPackOpen();
+// Where a loose file lives: the path itself if it exists, otherwise found from the executable
+std::string resolveAssetPath(const char* path);
+// The asset from the pack without copying, or else read from disk into storage
+bool loadAsset(const char* name, AssetSpan& span, std::vector<unsigned char>& storage);
+// When the asset was last written: the pack's time for packed assets
+bool assetModificationTime(const char* name, time_t& time);
+// Writes files (stored under the names given) into a new pack
+bool writeAssetPack(const char* outPath, const std::vector<std::string>& files);
+
+#endif
@@ -0,0 +1,265 @@
+#include "Atlas.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+int atlasWidth = 0;
+int atlasHeight = 0;
+
+// Constants
+const int ATLAS_MIN_WIDTH = 4096;
+const int ATLAS_BORDER = 1;  // Edge pixels are repeated into the border so filtering never picks up a neighbour
+const int ATLAS_SPACING = 2; // Extra empty pixels between neighbouring sprites
+// Cells start and end on this grid, so no BC3 block or texel of the first mip levels mixes two sprites
+const int ATLAS_BLOCK = 4;
+const int ATLAS_MIP_LEVELS = 3; // Level 2 texels still cover a single 4x4 cell block
+const char* const COOKED_ATLAS_PATH = "res/atlas.ktx";
+// Bumped whenever the table gains a field or the packing changes, so an older cook is repacked
+// rather than misread
+static const char* SPRITE_TABLE_KEY = "IceCream.sprites.v3";
+
+struct AtlasEntry {
+    Sprite* sprite;
+    std::string path;
+    TrimmedImage image;
+    int x, y; // Top-left of the visible part inside the atlas
+};
+
+static std::vector<AtlasEntry> pendingImages;
+
+void addAtlasImage(Sprite& sprite, const char* filePath) {
+    // Nothing is decoded yet: a cooked atlas may already hold the image
+    AtlasEntry entry;
+    entry.sprite = &sprite;
+    entry.path = filePath;
+    entry.x = entry.y = 0;
+    pendingImages.push_back(std::move(entry));
+}
+
+static int alignToBlock(int value) {
+    return (value + ATLAS_BLOCK - 1) / ATLAS_BLOCK * ATLAS_BLOCK;
+}
+
+// Atlas pixels an image of this size takes along one side. The image itself starts a whole
+// block into its cell, so its 4x4 blocks are the atlas's BC3 blocks and level 2 texels, which
+// is what buildSpriteHull() assumes; the border before it sits at the end of that first block.
+static int atlasCellSize(int imageSize) {
+    return alignToBlock(ATLAS_BLOCK + imageSize + ATLAS_BORDER + ATLAS_SPACING);
+}
+
+// Simple shelf packer: tallest images first, each shelf as high as its first image
+static void packEntries(std::vector<AtlasEntry*>& entries, int width, int& height) {
+    std::sort(entries.begin(), entries.end(), [](const AtlasEntry* a, const AtlasEntry* b) {
+        return a->image.height > b->image.height;
+    });
+
+    int shelfX = 0, shelfY = 0, shelfHeight = 0;
+    for (AtlasEntry* entry : entries) {
+        int cellWidth = atlasCellSize(entry->image.width);
+        int cellHeight = atlasCellSize(entry->image.height);
+        if (shelfX + cellWidth > width) {
+            shelfY += shelfHeight;
+            shelfX = 0;
+            shelfHeight = 0;
+        }
+        entry->x = shelfX + ATLAS_BLOCK;
+        entry->y = shelfY + ATLAS_BLOCK;
+        shelfX += cellWidth;
+        if (cellHeight > shelfHeight) shelfHeight = cellHeight;
+    }
+    height = shelfY + shelfHeight;
+}
+
+// Copies the image into the atlas and repeats its outermost pixels into the border
+static void blitEntry(std::vector<unsigned char>& atlas, const AtlasEntry& entry) {
+    const TrimmedImage& image = entry.image;
+    for (int y = -ATLAS_BORDER; y < image.height + ATLAS_BORDER; y++) {
+        int srcY = std::min(std::max(y, 0), image.height - 1);
+        unsigned char* dst = &atlas[((size_t)(entry.y + y) * atlasWidth + entry.x) * 4];
+        const unsigned char* src = &image.pixels[(size_t)srcY * image.width * 4];
+        memcpy(dst, src, (size_t)image.width * 4);
+        for (int b = 1; b <= ATLAS_BORDER; b++) {
+            memcpy(dst - b * 4, src, 4);
+            memcpy(dst + (image.width - 1 + b) * 4, src + (image.width - 1) * 4, 4);
+        }
+    }
+}
+
+static void decodeEntry(AtlasEntry& entry) {
+    if (!loadTrimmedImage(entry.path.c_str(), entry.image)) {
+        // Keep a single transparent pixel so the sprite still has somewhere to point
+        entry.image.width = entry.image.height = 1;
+        entry.image.pixels.assign(4, 0);
+    }
+    buildSpriteHull(entry.image.pixels.data(), entry.image.width, entry.image.height, entry.sprite->hull);
+}
+
+static void writeHullRects(std::ostream& out, const std::vector<HullRect>& rects) {
+    out << " " << rects.size();
+    for (const HullRect& r : rects) out << " " << r.x0 << " " << r.y0 << " " << r.x1 << " " << r.y1;
+}
+
+static bool readHullRects(std::istream& in, std::vector<HullRect>& rects) {
+    size_t count;
+    if (!(in >> count)) return false;
+    rects.resize(count);
+    for (HullRect& r : rects) {
+        if (!(in >> r.x0 >> r.y0 >> r.x1 >> r.y1)) return false;
+    }
+    return true;
+}
+
+// Images decode independently, so every hardware thread takes the next one still waiting
+static void decodePendingImages() {
+    std::atomic<size_t> next(0);
+    auto decodeRemaining = [&]() {
+        for (size_t i = next++; i < pendingImages.size(); i = next++) decodeEntry(pendingImages[i]);
+    };
+    size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), pendingImages.size());
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threadCount; i++) workers.push_back(std::thread(decodeRemaining));
+    decodeRemaining();
+    for (std::thread& worker : workers) worker.join();
+}
+
+// Decodes and packs every queued image; table gets one "path u0 v0 u1 v1 rect hull" line per
+// sprite, the hull as a count and the rectangles of the opaque part, then the same for the translucent part
+static bool packPendingImages(std::vector<unsigned char>& pixels, int maxSize, std::string* table) {
+    if (pendingImages.empty()) return false;
+
+    decodePendingImages();
+    std::vector<AtlasEntry*> entries;
+    int widest = 0;
+    for (auto& entry : pendingImages) {
+        entries.push_back(&entry);
+        widest = std::max(widest, atlasCellSize(entry.image.width));
+    }
+
+    atlasWidth = std::max(ATLAS_MIN_WIDTH, widest);
+    packEntries(entries, atlasWidth, atlasHeight);
+    atlasHeight = (atlasHeight + 15) & ~15;
+
+    if (atlasWidth > maxSize || atlasHeight > maxSize) {
+        std::cout << "Atlas " << atlasWidth << "x" << atlasHeight
+            << " is larger than the maximum texture size (" << maxSize << ")" << std::endl;
+        pendingImages.clear();
+        return false;
+    }
+
+    pixels.assign((size_t)atlasWidth * atlasHeight * 4, 0);
+    std::ostringstream lines;
+    lines.precision(9);
+    for (const AtlasEntry* entry : entries) {
+        blitEntry(pixels, *entry);
+
+        Sprite& sprite = *entry->sprite;
+        sprite.u0 = (float)entry->x / atlasWidth;
+        sprite.v0 = (float)entry->y / atlasHeight;
+        sprite.u1 = (float)(entry->x + entry->image.width) / atlasWidth;
+        sprite.v1 = (float)(entry->y + entry->image.height) / atlasHeight;
+        sprite.rect = entry->image.rect;
+        lines << entry->path << " " << sprite.u0 << " " << sprite.v0 << " " << sprite.u1 << " " << sprite.v1 << " "
+            << sprite.rect.offsetX << " " << sprite.rect.offsetY << " "
+            << sprite.rect.scaleX << " " << sprite.rect.scaleY;
+        writeHullRects(lines, sprite.hull.opaque);
+        writeHullRects(lines, sprite.hull.translucent);
+        lines << "\n";
+    }
+    pendingImages.clear();
+    if (table) *table = lines.str();
+
+    std::cout << "Atlas: " << entries.size() << " images packed into "
+        << atlasWidth << "x" << atlasHeight << std::endl;
+    return true;
+}
+
+bool packAtlas(std::vector<unsigned char>& pixels, int maxSize) {
+    return packPendingImages(pixels, maxSize, NULL);
+}
+
+bool cookAtlas(const char* outPath, bool compress) {
+    std::vector<unsigned char> pixels;
+    std::string table;
+    if (!packPendingImages(pixels, 16384, &table)) return false;
+
+    TextureFile file;
+    file.format = compress ? TEXTURE_BC3 : TEXTURE_RGBA8;
+    file.width = atlasWidth;
+    file.height = atlasHeight;
+    file.keyValues.push_back(std::make_pair(std::string("KTXorientation"), std::string("S=r,T=u")));
+    file.keyValues.push_back(std::make_pair(std::string(SPRITE_TABLE_KEY), table));
+    std::vector<std::vector<unsigned char>> levels;
+    buildMipChain(pixels.data(), atlasWidth, atlasHeight, ATLAS_MIP_LEVELS, levels);
+    if (compress) {
+        for (int level = 0; level < (int)levels.size(); level++) {
+            std::vector<unsigned char> blocks;
+            compressBC3(levels[level].data(), textureLevelWidth(file, level), textureLevelHeight(file, level), blocks);
+            levels[level].swap(blocks);
+        }
+    }
+    setTextureLevels(file, levels);
+    if (!writeTextureFile(outPath, file)) return false;
+
+    std::cout << "Cooked atlas: " << outPath << ", " << (compress ? "BC3" : "RGBA8") << ", "
+        << file.levels.size() << " levels, " << textureFileBytes(file) / 1024 << " KiB" << std::endl;
+    return true;
+}
+
+bool loadCookedAtlas(const char* path, TextureFile& file) {
+    if (pendingImages.empty()) return false;
+    time_t cookedTime;
+    if (!assetModificationTime(path, cookedTime)) return false;
+    // Art edited after cooking wins; images missing from disk (shipped without PNGs) are fine
+    for (const AtlasEntry& entry : pendingImages) {
+        time_t sourceTime;
+        if (assetModificationTime(entry.path.c_str(), sourceTime) && sourceTime > cookedTime) {
+            std::cout << path << " is older than " << entry.path << ", packing the images instead" << std::endl;
+            return false;
+        }
+    }
+    if (!readTextureFile(path, file)) return false;
+
+    std::string table = findTextureValue(file, SPRITE_TABLE_KEY);
+    if (table.empty()) {
+        std::cout << path << " was cooked by an older version, packing the images instead" << std::endl;
+        return false;
+    }
+    std::istringstream lines(table);
+    std::vector<std::pair<std::string, Sprite>> cooked;
+    std::string imagePath;
+    Sprite sprite;
+    while (lines >> imagePath >> sprite.u0 >> sprite.v0 >> sprite.u1 >> sprite.v1
+        >> sprite.rect.offsetX >> sprite.rect.offsetY >> sprite.rect.scaleX >> sprite.rect.scaleY) {
+        if (!readHullRects(lines, sprite.hull.opaque) || !readHullRects(lines, sprite.hull.translucent)) break;
+        cooked.push_back(std::make_pair(imagePath, sprite));
+    }
+    for (const AtlasEntry& entry : pendingImages) {
+        auto found = std::find_if(cooked.begin(), cooked.end(),
+            [&](const std::pair<std::string, Sprite>& c) { return c.first == entry.path; });
+        if (found == cooked.end()) {
+            std::cout << path << " does not contain " << entry.path << ", packing the images instead" << std::endl;
+            return false;
+        }
+        *entry.sprite = found->second;
+    }
+    atlasWidth = file.width;
+    atlasHeight = file.height;
+    pendingImages.clear();
+    return true;
+}
+
+bool prepareAtlas(TextureFile& file, int maxSize) {
+    if (loadCookedAtlas(COOKED_ATLAS_PATH, file)) return true;
+
+    std::vector<std::vector<unsigned char>> levels(1);
+    if (!packAtlas(levels[0], maxSize)) return false;
+    file = TextureFile();
+    file.format = TEXTURE_RGBA8;
+    file.width = atlasWidth;
+    file.height = atlasHeight;
+    setTextureLevels(file, levels);
+    return true;
+}
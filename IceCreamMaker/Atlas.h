@@ -0,0 +1,40 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "Hull.h"
+#include "Image.h"
+#include "TextureFile.h"
+
+// Where a layer image ended up inside the shared atlas texture
+struct Sprite {
+    float u0 = 0.0f, v0 = 0.0f; // Atlas texture coordinates of the visible part
+    float u1 = 1.0f, v1 = 1.0f;
+    TextureRect rect;           // Placement of the visible part inside the full-canvas quad
+    SpriteHull hull;            // Opaque and translucent parts of the visible part
+};
+
+// Global variables
+extern int atlasWidth;
+extern int atlasHeight;
+
+// Constants
+extern const char* const COOKED_ATLAS_PATH;
+
+// Function declarations
+// Queues an image for the atlas; the sprite is filled in by packAtlas()
+void addAtlasImage(Sprite& sprite, const char* filePath);
+// Packs every queued image into one RGBA image (bottom row first) and fills in their sprites.
+// Fails when there is nothing to pack or the result would be wider or taller than maxSize.
+bool packAtlas(std::vector<unsigned char>& pixels, int maxSize);
+// Packs the queued images and writes them with their mip levels (BC3 unless compress is off)
+// and the sprite placements, for loadCookedAtlas() to pick up on the next start
+bool cookAtlas(const char* outPath, bool compress = true);
+// Fills the queued sprites from a cooked atlas without decoding any image. Fails, leaving the
+// queue for packAtlas(), when the file is missing, older than an image or lacks one of them.
+bool loadCookedAtlas(const char* path, TextureFile& file);
+// Everything up to the GPU upload: the cooked atlas if it is current, otherwise the queued images
+// decoded on every core and packed into a single RGBA8 level. Needs no GL, so it can run on
+// another thread while the window and context are created.
+bool prepareAtlas(TextureFile& file, int maxSize = 16384);
+
+#endif
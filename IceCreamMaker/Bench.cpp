@@ -0,0 +1,486 @@
+// Microbenchmarks for the simulation hot paths: sprinkle physics and spawning, ice cream
+// drops, levers, spoon hit-testing and building the per-instance data the renderer draws
+// sprinkles from, plus the old array-of-structs sprinkle integrator
+// next to the current one. Every case restores the same prepared state before
+// each timed iteration, so iterations are identical and runs are comparable across builds.
+// Results go out as JSON; progress goes to stderr. Built by the Makefile only.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "Simulation.h"
+#include "Timing.h"
+
+// Every heap allocation in the process goes through here, so a case can count its own
+static unsigned long long allocationCount = 0;
+static unsigned long long allocationBytes = 0;
+
+void* operator new(std::size_t size) {
+    allocationCount++;
+    allocationBytes += size;
+    void* memory = std::malloc(size > 0 ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+const double STEP_SIZE = 1.0 / 120.0;
+const size_t SPRINKLE_COUNTS[] = { 300, 3000, 30000, 300000, 1000000 };
+const int BITE_COUNTS[] = { 1, 16, 256 };
+
+// State mixes for the physics cases; MIX_ALL draws each sprinkle's state at random
+enum SprinkleMix {
+    MIX_FALLING = SPRINKLE_FALLING,
+    MIX_IN_TUNNEL = SPRINKLE_IN_TUNNEL,
+    MIX_DROPPING = SPRINKLE_DROPPING,
+    MIX_SETTLED = SPRINKLE_SETTLED,
+    MIX_ALL
+};
+const char* MIX_NAMES[] = { "falling", "in_tunnel", "dropping", "settled", "all" };
+
+struct BenchOptions {
+    double minTime = 0.2;        // Timed seconds per case, at least
+    size_t maxCount = 1000000;   // Skip sprinkle counts above this
+    std::string filter;          // Only cases whose name contains this
+    uint64_t seed = 1;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string family;
+    size_t particles = 0;        // Work items per iteration: sprinkles, drops, levers or bites
+    std::string mix;
+    bool pours = false;
+    int bites = 0;
+    size_t iterations = 0;
+    double nsMedian = 0.0, nsMean = 0.0, nsMin = 0.0;
+    double allocationsPerIteration = 0.0;
+    double allocatedBytesPerIteration = 0.0;
+};
+
+// Times step() until minTime has been spent in it, calling restore() untimed before each
+// iteration. Allocations are only counted inside step().
+template <typename Restore, typename Step>
+static void measure(const BenchOptions& options, BenchResult& result, Restore restore, Step step) {
+    std::vector<double> samples;
+    unsigned long long allocations = 0, bytes = 0;
+    double timed = 0.0;
+
+    // One untimed warm-up, then at least five samples
+    restore();
+    step();
+    while (timed < options.minTime || samples.size() < 5) {
+        restore();
+        unsigned long long allocationsBefore = allocationCount, bytesBefore = allocationBytes;
+        double start = timingNow();
+        step();
+        double elapsed = timingNow() - start;
+        allocations += allocationCount - allocationsBefore;
+        bytes += allocationBytes - bytesBefore;
+        samples.push_back(elapsed);
+        timed += elapsed;
+    }
+
+    result.iterations = samples.size();
+    result.nsMean = timed * 1e9 / samples.size();
+    result.allocationsPerIteration = (double)allocations / samples.size();
+    result.allocatedBytesPerIteration = (double)bytes / samples.size();
+    std::sort(samples.begin(), samples.end());
+    result.nsMin = samples.front() * 1e9;
+    result.nsMedian = samples[samples.size() / 2] * 1e9;
+}
+
+static bool wanted(const BenchOptions& options, const std::string& name) {
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+// Pulls the vanilla and chocolate levers and lets them run long enough to fill the cup and
+// keep a steady stream of drops in the air
+static void startPours(SimulationContext& simulation) {
+    toggleFlavor(simulation, 1);
+    toggleFlavor(simulation, 2);
+    for (int step = 0; step < 360; step++) {
+        updateLevers(simulation.levers, (float)STEP_SIZE);
+        updateIceCreamDrops(simulation.iceCream, (float)STEP_SIZE);
+    }
+}
+
+// count sprinkles spread over the screen, all in the mix's state (or a random one for MIX_ALL)
+static void prepareSprinkles(SimulationContext& simulation, size_t count, SprinkleMix mix) {
+    SprinkleSystem& sprinkles = simulation.sprinkles;
+    // Keep resting sprinkles live so every iteration sees the same population
+    sprinkles.bakingEnabled = false;
+    spawnBenchmarkSprinkles(sprinkles, count);
+
+    SprinkleStore& s = sprinkles.store;
+    RandomStream& random = sprinkles.benchmarkRandom;
+    if (mix == MIX_ALL) fillRandomIndices(random, &s.state[0], count, 4);
+    else std::fill_n(&s.state[0], count, (uint8_t)mix);
+
+    for (size_t i = 0; i < count; i++) {
+        switch (s.state[i]) {
+        case SPRINKLE_FALLING:
+        case SPRINKLE_DROPPING:
+            s.vx[i] = randomFloat(random, -0.1f, 0.1f);
+            s.vy[i] = randomFloat(random, -0.3f, 0.0f);
+            s.rotationSpeed[i] = randomFloat(random, -1.0f, 1.0f);
+            break;
+        case SPRINKLE_IN_TUNNEL:
+        {
+            // Queued for good, so the sprinkle stays in the tunnel however often the step repeats
+            TunnelEntry entry;
+            entry.handle = s.handleOf(i);
+            entry.entryTime = 1.0e9; // Its slide never ends
+            sprinkles.tunnelQueue.push_back(entry);
+            break;
+        }
+        case SPRINKLE_SETTLED:
+            s.vx[i] = randomFloat(random, -0.1f, 0.1f);
+            s.rotationSpeed[i] = randomFloat(random, -1.0f, 1.0f);
+            break;
+        }
+    }
+}
+
+static void benchSprinklePhysics(const BenchOptions& options, std::vector<BenchResult>& results) {
+    for (size_t count : SPRINKLE_COUNTS) {
+        if (count > options.maxCount) continue;
+        for (int mix = MIX_FALLING; mix <= MIX_ALL; mix++) {
+            for (int pours = 0; pours <= 1; pours++) {
+                BenchResult result;
+                result.family = "sprinkle_physics";
+                result.particles = count;
+                result.mix = MIX_NAMES[mix];
+                result.pours = pours != 0;
+                result.name = result.family + "/" + std::to_string(count) + "/" + result.mix +
+                    (pours ? "/pours_on" : "/pours_off");
+                if (!wanted(options, result.name)) continue;
+                std::cerr << result.name << std::endl;
+
+                SimulationContext prepared;
+                initSimulation(prepared, count);
+                seedSprinkles(prepared.sprinkles, options.seed);
+                if (pours) startPours(prepared);
+                prepareSprinkles(prepared, count, (SprinkleMix)mix);
+
+                SimulationContext work = prepared;
+                measure(options, result,
+                    [&]() { work.sprinkles = prepared.sprinkles; },
+                    [&]() { updateSprinklesPhysics(work.sprinkles, work.iceCream, STEP_SIZE); });
+                results.push_back(result);
+            }
+        }
+    }
+}
+
+// The Sprinkle struct sprinkles were stored in before SprinkleStore, field for field
+struct AosSprinkle {
+    float x, y;
+    float vx, vy;
+    float size;
+    float rotation;
+    float rotationSpeed;
+    bool active;
+    float color[7];
+    float slideTimer;
+    bool isInTunnel;
+    bool waitingToExit;
+    float waitTimer;
+    int collisionState;
+};
+
+// The movement part of the old per-sprinkle update, branching on each sprinkle's state
+static void integrateAosSprinkles(std::vector<AosSprinkle>& sprinkles, float dt) {
+    for (AosSprinkle& drop : sprinkles) {
+        if (!drop.active) continue;
+        if (drop.collisionState == SPRINKLE_FALLING) drop.vy += GRAVITYS * dt;
+        drop.x += drop.vx * dt;
+        drop.y += drop.vy * dt;
+        if (drop.collisionState == SPRINKLE_FALLING) drop.rotation += drop.rotationSpeed * dt;
+        if (drop.collisionState == SPRINKLE_DROPPING) {
+            drop.vy += GRAVITYS * dt;
+            drop.x += drop.vx * dt;
+            drop.y += drop.vy * dt;
+            drop.rotation += drop.rotationSpeed * dt;
+        }
+    }
+}
+
+static void benchSprinkleIntegrate(const BenchOptions& options, std::vector<BenchResult>& results) {
+    for (size_t count : SPRINKLE_COUNTS) {
+        if (count > options.maxCount) continue;
+        // The same sprinkles in both layouts
+        SimulationContext prepared;
+        initSimulation(prepared, count);
+        seedSprinkles(prepared.sprinkles, options.seed);
+        prepareSprinkles(prepared, count, MIX_ALL);
+        const SprinkleStore& s = prepared.sprinkles.store;
+        std::vector<AosSprinkle> preparedAos(count);
+        for (size_t i = 0; i < count; i++) {
+            AosSprinkle& drop = preparedAos[i];
+            drop = AosSprinkle();
+            drop.x = s.x[i];
+            drop.y = s.y[i];
+            drop.vx = s.vx[i];
+            drop.vy = s.vy[i];
+            drop.size = s.size[i];
+            drop.rotation = s.rotation[i];
+            drop.rotationSpeed = s.rotationSpeed[i];
+            drop.active = true;
+            drop.collisionState = s.state[i];
+            drop.isInTunnel = s.state[i] == SPRINKLE_IN_TUNNEL;
+        }
+
+        for (int soa = 0; soa <= 1; soa++) {
+            BenchResult result;
+            result.family = soa ? "sprinkle_integrate_soa" : "sprinkle_integrate_aos";
+            result.particles = count;
+            result.mix = MIX_NAMES[MIX_ALL];
+            result.name = result.family + "/" + std::to_string(count) + "/" + result.mix;
+            if (!wanted(options, result.name)) continue;
+            std::cerr << result.name << std::endl;
+
+            if (soa) {
+                SprinkleStore work = s;
+                measure(options, result,
+                    [&]() { work = s; },
+                    [&]() { integrateSprinkles(work, (float)STEP_SIZE); });
+            }
+            else {
+                std::vector<AosSprinkle> work = preparedAos;
+                measure(options, result,
+                    [&]() { work = preparedAos; },
+                    [&]() { integrateAosSprinkles(work, (float)STEP_SIZE); });
+            }
+            results.push_back(result);
+        }
+    }
+}
+
+static void benchSprinkleSpawn(const BenchOptions& options, std::vector<BenchResult>& results) {
+    for (size_t count : SPRINKLE_COUNTS) {
+        if (count > options.maxCount) continue;
+        // Batched spawn into an empty pool, and one-at-a-time spawns the way the nozzle does them
+        for (int batched = 1; batched >= 0; batched--) {
+            BenchResult result;
+            result.family = batched ? "sprinkle_spawn_batch" : "sprinkle_spawn_single";
+            result.particles = count;
+            result.name = result.family + "/" + std::to_string(count);
+            if (!wanted(options, result.name)) continue;
+            std::cerr << result.name << std::endl;
+
+            SimulationContext simulation;
+            initSimulation(simulation, count);
+            seedSprinkles(simulation.sprinkles, options.seed);
+            simulation.sprinkles.open = true;
+            measure(options, result,
+                [&]() { simulation.sprinkles.store.clear(); },
+                [&]() {
+                    if (batched) spawnSprinklesBatch(simulation.sprinkles, count);
+                    else for (size_t n = 0; n < count; n++) spawnSprinkles(simulation.sprinkles);
+                });
+            results.push_back(result);
+        }
+    }
+}
+
+// The CPU side of the instanced sprinkle draw: resting sprinkles, as --sprinkle-bench scatters them
+static void benchSprinkleInstances(const BenchOptions& options, std::vector<BenchResult>& results) {
+    for (size_t count : SPRINKLE_COUNTS) {
+        if (count > options.maxCount) continue;
+        BenchResult result;
+        result.family = "sprinkle_instances";
+        result.particles = count;
+        result.name = result.family + "/" + std::to_string(count);
+        if (!wanted(options, result.name)) continue;
+        std::cerr << result.name << std::endl;
+
+        SimulationContext simulation;
+        initSimulation(simulation, count);
+        seedSprinkles(simulation.sprinkles, options.seed);
+        spawnBenchmarkSprinkles(simulation.sprinkles, count);
+        std::vector<SprinkleInstance> instances;
+        instances.reserve(count);
+        measure(options, result,
+            [&]() {},
+            [&]() { buildSprinkleInstances(simulation.sprinkles, 0.5f, instances); });
+        results.push_back(result);
+    }
+}
+
+static void benchIceCreamDrops(const BenchOptions& options, std::vector<BenchResult>& results) {
+    for (int pours = 0; pours <= 1; pours++) {
+        BenchResult result;
+        result.family = "ice_cream_drops";
+        result.pours = pours != 0;
+        result.name = result.family + (pours ? "/pours_on" : "/pours_off");
+        if (!wanted(options, result.name)) continue;
+        std::cerr << result.name << std::endl;
+
+        SimulationContext prepared;
+        initSimulation(prepared, 0);
+        if (pours) startPours(prepared);
+        result.particles = std::max<size_t>(prepared.iceCream.drops.size(), 1);
+
+        IceCreamState work = prepared.iceCream;
+        measure(options, result,
+            [&]() { work = prepared.iceCream; },
+            [&]() { updateIceCreamDrops(work, (float)STEP_SIZE); });
+        results.push_back(result);
+    }
+}
+
+static void benchLevers(const BenchOptions& options, std::vector<BenchResult>& results) {
+    BenchResult result;
+    result.family = "levers";
+    result.name = result.family;
+    result.particles = 3;
+    if (!wanted(options, result.name)) return;
+    std::cerr << result.name << std::endl;
+
+    // Levers halfway through their travel, so every branch moves one
+    LeverState prepared;
+    prepared.vanilla = true;
+    prepared.leverPositionVanilla = 0.5f;
+    prepared.leverPositionChocolate = 0.5f;
+    prepared.leverPositionMixed = 0.5f;
+    LeverState work = prepared;
+    measure(options, result,
+        [&]() { work = prepared; },
+        [&]() { updateLevers(work, (float)STEP_SIZE); });
+    results.push_back(result);
+}
+
+static void benchBites(const BenchOptions& options, std::vector<BenchResult>& results) {
+    for (int bites : BITE_COUNTS) {
+        // Spoonfuls that land on the ice cream, and clicks that miss the cup entirely
+        for (int hit = 1; hit >= 0; hit--) {
+            BenchResult result;
+            result.family = hit ? "bite_hit" : "bite_miss";
+            result.particles = bites;
+            result.bites = bites;
+            result.pours = true;
+            result.name = result.family + "/" + std::to_string(bites);
+            if (!wanted(options, result.name)) continue;
+            std::cerr << result.name << std::endl;
+
+            SimulationContext prepared;
+            initSimulation(prepared, 0);
+            startPours(prepared);
+            // Deep enough that every spoonful of the iteration lands
+            prepared.iceCream.vanillaFill.fillLevel = CUP_TOP_POS_Y + bites * 0.15f;
+            prepared.iceCream.chocolateFill.fillLevel = CUP_TOP_POS_Y + bites * 0.15f;
+            prepared.biteMarks.reserve(bites);
+
+            // Inside the cup just above its bottom, or off to the left of it
+            const float biteX = hit ? 0.3f : -0.8f;
+            const float biteY = CUP_BOTTOM_POS_Y + 0.02f;
+            SimulationContext work = prepared;
+            measure(options, result,
+                [&]() {
+                    work.iceCream = prepared.iceCream;
+                    work.biteMarks.clear();
+                },
+                [&]() {
+                    for (int n = 0; n < bites; n++) biteAt(work, biteX, biteY);
+                });
+            results.push_back(result);
+        }
+    }
+}
+
+static void writeJson(std::ostream& out, const BenchOptions& options, const std::vector<BenchResult>& results) {
+    char number[64];
+    out << "{\n  \"benchmark\": \"icecream_sim\",\n  \"seed\": " << options.seed
+        << ",\n  \"step_seconds\": " << STEP_SIZE << ",\n  \"cases\": [\n";
+    for (size_t n = 0; n < results.size(); n++) {
+        const BenchResult& r = results[n];
+        double nsPerParticle = r.nsMedian / (r.particles > 0 ? r.particles : 1);
+        out << "    {\"name\": \"" << r.name << "\", \"family\": \"" << r.family << "\"";
+        out << ", \"particles\": " << r.particles;
+        if (!r.mix.empty()) out << ", \"mix\": \"" << r.mix << "\"";
+        out << ", \"pours\": " << (r.pours ? "true" : "false") << ", \"bites\": " << r.bites;
+        out << ", \"iterations\": " << r.iterations;
+        std::snprintf(number, sizeof(number), "%.1f", r.nsMedian);
+        out << ", \"ns_per_iter_median\": " << number;
+        std::snprintf(number, sizeof(number), "%.1f", r.nsMean);
+        out << ", \"ns_per_iter_mean\": " << number;
+        std::snprintf(number, sizeof(number), "%.1f", r.nsMin);
+        out << ", \"ns_per_iter_min\": " << number;
+        std::snprintf(number, sizeof(number), "%.3f", nsPerParticle);
+        out << ", \"ns_per_particle\": " << number;
+        std::snprintf(number, sizeof(number), "%.0f", nsPerParticle > 0.0 ? 1e9 / nsPerParticle : 0.0);
+        out << ", \"particles_per_second\": " << number;
+        std::snprintf(number, sizeof(number), "%.2f", r.allocationsPerIteration);
+        out << ", \"allocs_per_iter\": " << number;
+        std::snprintf(number, sizeof(number), "%.1f", r.allocatedBytesPerIteration);
+        out << ", \"alloc_bytes_per_iter\": " << number << "}";
+        out << (n + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    // --filter TEXT: only run cases whose name contains TEXT, e.g. sprinkle_physics/30000
+    // --min-time N: timed seconds per case (default 0.2)
+    // --max-count N: skip sprinkle counts above N (1000000 runs everything)
+    // --seed N: seed for the prepared sprinkles
+    // --out FILE: write the JSON there instead of stdout
+    BenchOptions options;
+    std::string outPath;
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        }
+        else if (option == "--min-time" && i + 1 < argc) {
+            options.minTime = std::stod(argv[++i]);
+        }
+        else if (option == "--max-count" && i + 1 < argc) {
+            options.maxCount = std::stoul(argv[++i]);
+        }
+        else if (option == "--seed" && i + 1 < argc) {
+            options.seed = std::stoull(argv[++i]);
+        }
+        else if (option == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    benchSprinklePhysics(options, results);
+    benchSprinkleIntegrate(options, results);
+    benchSprinkleSpawn(options, results);
+    benchSprinkleInstances(options, results);
+    benchIceCreamDrops(options, results);
+    benchLevers(options, results);
+    benchBites(options, results);
+
+    if (outPath.empty()) {
+        writeJson(std::cout, options, results);
+    }
+    else {
+        std::ofstream out(outPath);
+        if (!out) {
+            std::cerr << "Failed to open " << outPath << std::endl;
+            return 1;
+        }
+        writeJson(out, options, results);
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+// Offline converter for the texture atlas: decodes and packs every scene image once, builds
+// the mip levels, BC3-compresses them and writes a KTX file the game uploads without decoding
+// anything. Run it from this directory after changing anything in res/ (make atlas does).
+// Built by the Makefile only; the Visual Studio project keeps Main.cpp as its single entry point.
+#include <iostream>
+#include <string>
+#include "Scene.h"
+#include "Timing.h"
+
+int main(int argc, char** argv) {
+    // --out PATH: where to write the atlas (default res/atlas.ktx, where the game looks)
+    // --raw: keep plain RGBA8 levels instead of BC3
+    std::string outPath = COOKED_ATLAS_PATH;
+    bool compress = true;
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+        else if (option == "--raw") {
+            compress = false;
+        }
+        else {
+            std::cout << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    double startTime = timingNow();
+    SceneSprites sprites;
+    addSceneImages(sprites);
+    if (!cookAtlas(outPath.c_str(), compress)) return 1;
+    std::cout << "Took " << (timingNow() - startTime) * 1000.0 << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "DrawList.h"
+
+void clearDrawList(DrawList& list) {
+    list.quads.clear();
+    list.sprinkles.clear();
+    list.commands.clear();
+    list.openLayer = 0;
+    list.sealedCommands = 0;
+    list.overlayStart = (size_t)-1;
+}
+
+SpriteQuad makeSpriteQuad(const Sprite& sprite, float posX, float posY, float scaleX, float scaleY) {
+    // Shrink the full-canvas quad down to the visible part of the image
+    float centerX = posX + scaleX * sprite.rect.offsetX;
+    float centerY = posY + scaleY * sprite.rect.offsetY;
+    float halfX = scaleX * sprite.rect.scaleX;
+    float halfY = scaleY * sprite.rect.scaleY;
+
+    SpriteQuad quad;
+    quad.left = centerX - halfX;
+    quad.right = centerX + halfX;
+    quad.bottom = centerY - halfY;
+    quad.top = centerY + halfY;
+    quad.u0 = sprite.u0;
+    quad.v0 = sprite.v0;
+    quad.u1 = sprite.u1;
+    quad.v1 = sprite.v1;
+    quad.hull = isHullEmpty(sprite.hull) ? nullptr : &sprite.hull;
+    return quad;
+}
+
+void addSprite(DrawList& list, const Sprite& sprite, float posX, float posY, float scaleX, float scaleY) {
+    if (list.commands.size() <= list.sealedCommands || list.commands.back().type != DRAW_SPRITES) {
+        list.commands.push_back({ DRAW_SPRITES, list.quads.size(), 0 });
+    }
+    list.quads.push_back(makeSpriteQuad(sprite, posX, posY, scaleX, scaleY));
+    list.commands.back().count++;
+}
+
+void addSprinkles(DrawList& list, const SprinkleSystem& sprinkles, float alpha) {
+    if (sprinkles.store.empty()) return;
+
+    // buildSprinkleInstances() fills a whole array, so only the first batch of a frame goes in directly
+    size_t first = list.sprinkles.size();
+    if (first == 0) {
+        buildSprinkleInstances(sprinkles, alpha, list.sprinkles);
+    }
+    else {
+        buildSprinkleInstances(sprinkles, alpha, list.scratch);
+        list.sprinkles.insert(list.sprinkles.end(), list.scratch.begin(), list.scratch.end());
+    }
+    list.commands.push_back({ DRAW_SPRINKLES, first, list.sprinkles.size() - first });
+}
+
+void addToppings(DrawList& list) {
+    list.commands.push_back({ DRAW_TOPPINGS, 0, 0 });
+}
+
+void beginLayer(DrawList& list, int layer) {
+    list.openLayer = list.commands.size();
+    list.commands.push_back({ DRAW_LAYER, (size_t)layer, 0 });
+}
+
+void endLayer(DrawList& list) {
+    list.commands[list.openLayer].count = list.commands.size() - list.openLayer - 1;
+    list.sealedCommands = list.commands.size();
+}
+
+void beginOverlay(DrawList& list) {
+    list.overlayStart = list.commands.size();
+    list.sealedCommands = list.commands.size();
+}
+
+size_t firstOverlayCommand(const DrawList& list) {
+    return list.overlayStart < list.commands.size() ? list.overlayStart : list.commands.size();
+}
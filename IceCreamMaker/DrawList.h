@@ -0,0 +1,61 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <vector>
+#include "Atlas.h"
+#include "Sprinkles.h"
+
+// One frame's worth of drawing, in order and independent of who draws it: the GL
+// renderer and the software rasterizer both consume the same list.
+
+// Atlas quad already placed on screen (NDC), axis aligned
+struct SpriteQuad {
+    float left, bottom, right, top;
+    float u0, v0, u1, v1;
+    const SpriteHull* hull; // The sprite's, or nullptr to treat the whole quad as translucent
+};
+
+enum DrawCommandType {
+    DRAW_SPRITES,   // quads[first, first + count) from the atlas, alpha blended
+    DRAW_SPRINKLES, // sprinkles[first, first + count) as round particles
+    DRAW_TOPPINGS,  // The baked toppings layer over the TOPPINGS_* area
+    DRAW_LAYER      // The next count commands (sprites only) are layer number first; a renderer
+                    // may keep them composited and redraw only when their quads change
+};
+
+struct DrawCommand {
+    DrawCommandType type;
+    size_t first, count;
+};
+
+struct DrawList {
+    std::vector<SpriteQuad> quads;
+    std::vector<SprinkleInstance> sprinkles;
+    std::vector<DrawCommand> commands;
+    std::vector<SprinkleInstance> scratch;
+    size_t openLayer = 0;      // Index of the DRAW_LAYER command beginLayer() added
+    size_t sealedCommands = 0; // Commands before this belong to a closed layer; sprites never merge into them
+    size_t overlayStart = (size_t)-1; // First command of the overlay, if beginOverlay() was called
+};
+
+// Function declarations
+void clearDrawList(DrawList& list);
+// Where drawSprite() puts a sprite; arguments match the old drawRect() translation/scale
+SpriteQuad makeSpriteQuad(const Sprite& sprite, float posX = 0.0f, float posY = 0.0f,
+    float scaleX = 1.0f, float scaleY = 1.0f);
+// Consecutive sprites share one command
+void addSprite(DrawList& list, const Sprite& sprite, float posX = 0.0f, float posY = 0.0f,
+    float scaleX = 1.0f, float scaleY = 1.0f);
+// Every live sprinkle, alpha of the way through the last step
+void addSprinkles(DrawList& list, const SprinkleSystem& sprinkles, float alpha);
+void addToppings(DrawList& list);
+// Everything added until endLayer() becomes one layer; layers don't nest
+void beginLayer(DrawList& list, int layer);
+void endLayer(DrawList& list);
+// Everything added from here on is the overlay (the cursor): a renderer drawing the scene at a
+// lower resolution draws it afterwards, at full resolution
+void beginOverlay(DrawList& list);
+// commands.size() when there is no overlay
+size_t firstOverlayCommand(const DrawList& list);
+
+#endif
@@ -0,0 +1,68 @@
+#include "FrameSnapshot.h"
+
+// Constants
+static const int SNAPSHOT_FRESH = 4;
+static const int SNAPSHOT_SLOT_MASK = 3;
+
+// Global variables
+static std::vector<SprinkleInstance> settledInstances; // Writer side only
+
+void initSnapshotBuffer(SnapshotBuffer& buffer) {
+    buffer.writing = 0;
+    buffer.shared.store(1, std::memory_order_relaxed);
+    buffer.reading = 2;
+    buffer.published = 0;
+    buffer.dropped = 0;
+    for (FrameSnapshot& snapshot : buffer.slots) {
+        clearDrawList(snapshot.drawList);
+        snapshot.settled.clear();
+        snapshot.sequence = 0;
+    }
+}
+
+FrameSnapshot& writableSnapshot(SnapshotBuffer& buffer) {
+    return buffer.slots[buffer.writing];
+}
+
+void takeSettledSprinkles(FrameSnapshot& snapshot, SprinkleSystem& sprinkles) {
+    // Sprinkles carried over from before a reset belong to a cup that has been emptied
+    if (snapshot.resetCount != sprinkles.resetCount) {
+        snapshot.settled.clear();
+        snapshot.resetCount = sprinkles.resetCount;
+    }
+    if (sprinkles.settled.empty()) return;
+    buildSettledInstances(sprinkles, settledInstances);
+    snapshot.settled.insert(snapshot.settled.end(), settledInstances.begin(), settledInstances.end());
+    sprinkles.settled.clear();
+}
+
+bool publishSnapshot(SnapshotBuffer& buffer) {
+    buffer.slots[buffer.writing].sequence = ++buffer.published;
+    // Release: the reader sees the whole snapshot once it sees the index
+    int previous = buffer.shared.exchange(buffer.writing | SNAPSHOT_FRESH, std::memory_order_acq_rel);
+    buffer.writing = previous & SNAPSHOT_SLOT_MASK;
+    FrameSnapshot& next = buffer.slots[buffer.writing];
+    if (previous & SNAPSHOT_FRESH) {
+        // Never drawn, so its settled sprinkles were never baked: keep them for the next one
+        buffer.dropped++;
+        return false;
+    }
+    next.settled.clear();
+    return true;
+}
+
+bool hasFreshSnapshot(const SnapshotBuffer& buffer) {
+    return (buffer.shared.load(std::memory_order_acquire) & SNAPSHOT_FRESH) != 0;
+}
+
+bool takeSnapshot(SnapshotBuffer& buffer) {
+    // Only the reader clears the flag, so a fresh slot stays fresh until the exchange below
+    if (!hasFreshSnapshot(buffer)) return false;
+    int previous = buffer.shared.exchange(buffer.reading, std::memory_order_acq_rel);
+    buffer.reading = previous & SNAPSHOT_SLOT_MASK;
+    return true;
+}
+
+const FrameSnapshot& readableSnapshot(const SnapshotBuffer& buffer) {
+    return buffer.slots[buffer.reading];
+}
@@ -0,0 +1,48 @@
+#ifndef FRAME_SNAPSHOT_H
+#define FRAME_SNAPSHOT_H
+
+// What the simulation thread hands the render thread for one frame: the finished draw list (it
+// already holds every lever, pour, fill, sprinkle, bite and the spoon, placed and interpolated)
+// plus the sprinkles that settled since the last snapshot the renderer took.
+//
+// Three snapshots rotate between the two threads without a lock. The writer fills its own slot
+// and swaps it into the shared one; the reader swaps the shared slot for its own when a newer
+// one is there. Neither ever waits for the other, and the reader always gets the newest frame.
+// A snapshot replaced before the reader took it is dropped, except for its settled sprinkles,
+// which ride along with the next one so none of them are missing from the toppings.
+
+#include <atomic>
+#include <vector>
+#include "DrawList.h"
+
+struct FrameSnapshot {
+    DrawList drawList;
+    std::vector<SprinkleInstance> settled; // To bake into the toppings before drawing
+    unsigned int resetCount = 0;           // The sprinkles' when settled was taken
+    float renderScale = 1.0f;              // Scene resolution the frame wants
+    unsigned long long sequence = 0;
+};
+
+struct SnapshotBuffer {
+    FrameSnapshot slots[3];
+    std::atomic<int> shared;     // Slot between the threads, | SNAPSHOT_FRESH until the reader takes it
+    int writing = 0, reading = 2;
+    unsigned long long published = 0;
+    unsigned long long dropped = 0; // Replaced before the reader took them
+};
+
+// Function declarations
+void initSnapshotBuffer(SnapshotBuffer& buffer);
+// Writer side: the slot to fill next
+FrameSnapshot& writableSnapshot(SnapshotBuffer& buffer);
+// Moves the sprinkles that settled in the simulation into the snapshot being written
+void takeSettledSprinkles(FrameSnapshot& snapshot, SprinkleSystem& sprinkles);
+// Hands the written snapshot to the reader; returns false when it replaced one the reader never took
+bool publishSnapshot(SnapshotBuffer& buffer);
+// Reader side: whether a snapshot newer than the one it holds is waiting
+bool hasFreshSnapshot(const SnapshotBuffer& buffer);
+// Swaps in the newest snapshot, if there is one; readableSnapshot() stays valid until the next call
+bool takeSnapshot(SnapshotBuffer& buffer);
+const FrameSnapshot& readableSnapshot(const SnapshotBuffer& buffer);
+
+#endif
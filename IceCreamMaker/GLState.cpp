@@ -0,0 +1,116 @@
+#include "GLState.h"
+#include <GL/glew.h>
+
+// Constants
+static const char* const UNIFORM_NAMES[UNIFORM_COUNT] = { "uTranslation", "uScale", "uTex", "uAspect", "uView",
+    "uDepth", "uOverdraw" };
+static const unsigned int MAX_TEXTURE_UNITS = 16;
+// Never a real object name, so the first bind after a reset always goes through
+static const unsigned int UNKNOWN_BINDING = 0xFFFFFFFFu;
+
+// Global variables
+static unsigned int currentProgram = UNKNOWN_BINDING;
+static unsigned int currentTextureUnit = UNKNOWN_BINDING;
+static unsigned int currentTextures[MAX_TEXTURE_UNITS];
+static unsigned int currentVertexArray = UNKNOWN_BINDING;
+static int currentBlendMode = -1;
+static bool overdrawView = false;
+static bool stateKnown = false;
+static GLStateStats stats;
+
+void initShaderProgram(ShaderProgram& shader, unsigned int program) {
+    shader.id = program;
+    for (int uniform = 0; uniform < UNIFORM_COUNT; uniform++) {
+        shader.uniforms[uniform] = program != 0 ? glGetUniformLocation(program, UNIFORM_NAMES[uniform]) : -1;
+    }
+}
+
+void destroyShaderProgram(ShaderProgram& shader) {
+    if (shader.id != 0 && shader.id == currentProgram) currentProgram = UNKNOWN_BINDING;
+    glDeleteProgram(shader.id);
+    shader.id = 0;
+}
+
+void resetGLState() {
+    currentProgram = UNKNOWN_BINDING;
+    currentTextureUnit = UNKNOWN_BINDING;
+    for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) currentTextures[unit] = UNKNOWN_BINDING;
+    currentVertexArray = UNKNOWN_BINDING;
+    currentBlendMode = -1;
+    stateKnown = true;
+}
+
+void useProgram(const ShaderProgram& shader) {
+    if (shader.id == currentProgram) {
+        stats.programSkips++;
+        return;
+    }
+    glUseProgram(shader.id);
+    currentProgram = shader.id;
+    stats.programBinds++;
+}
+
+void bindTexture2D(unsigned int unit, unsigned int texture) {
+    if (!stateKnown) resetGLState();
+    if (unit < MAX_TEXTURE_UNITS && currentTextures[unit] == texture) {
+        stats.textureSkips++;
+        return;
+    }
+    if (unit != currentTextureUnit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        currentTextureUnit = unit;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (unit < MAX_TEXTURE_UNITS) currentTextures[unit] = texture;
+    stats.textureBinds++;
+}
+
+void bindVertexArray(unsigned int vertexArray) {
+    if (vertexArray == currentVertexArray) {
+        stats.vertexArraySkips++;
+        return;
+    }
+    glBindVertexArray(vertexArray);
+    currentVertexArray = vertexArray;
+    stats.vertexArrayBinds++;
+}
+
+void setBlendMode(BlendMode mode) {
+    if (overdrawView) mode = BLEND_ADDITIVE;
+    if (mode == currentBlendMode) {
+        stats.blendSkips++;
+        return;
+    }
+    if (mode == BLEND_OFF) glDisable(GL_BLEND);
+    else if (currentBlendMode == BLEND_OFF || currentBlendMode < 0) glEnable(GL_BLEND);
+    switch (mode) {
+    case BLEND_OFF:
+        break;
+    case BLEND_ALPHA:
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+    case BLEND_PREMULTIPLIED:
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+    case BLEND_COMPOSITE:
+        glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+    case BLEND_ADDITIVE:
+        glBlendFunc(GL_ONE, GL_ONE);
+        break;
+    }
+    currentBlendMode = mode;
+    stats.blendChanges++;
+}
+
+void setOverdrawView(bool enabled) {
+    overdrawView = enabled;
+    // Whatever is set now may be the wrong one of the two
+    currentBlendMode = -1;
+}
+
+GLStateStats takeGLStateStats() {
+    GLStateStats taken = stats;
+    stats = GLStateStats();
+    return taken;
+}
@@ -0,0 +1,58 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+// Shader programs with their uniform locations looked up once at link time, and a shadow copy
+// of the GL bindings so that binding what is already bound never reaches the driver. Every
+// program, 2D texture and vertex array bind goes through here; code that binds directly (or
+// deletes something still bound mid-run) calls resetGLState() afterwards. Blending is switched
+// through setBlendMode() the same way.
+
+// Every uniform the game's shaders use
+enum ShaderUniform {
+    UNIFORM_TRANSLATION, // rect.vert
+    UNIFORM_SCALE,
+    UNIFORM_TEXTURE,     // rect.frag
+    UNIFORM_ASPECT,      // particle.vert
+    UNIFORM_VIEW,
+    UNIFORM_DEPTH,       // Both vertex shaders: depth of everything the draw covers
+    UNIFORM_OVERDRAW,    // Both fragment shaders: 1 for the overdraw heat map
+    UNIFORM_COUNT
+};
+
+enum BlendMode {
+    BLEND_OFF,
+    BLEND_ALPHA,         // Straight alpha, the game's default
+    BLEND_PREMULTIPLIED, // Colors already multiplied by their alpha (composited layers)
+    BLEND_COMPOSITE,     // Straight color in, premultiplied color and accumulated coverage out
+    BLEND_ADDITIVE       // Every fragment adds its color (the overdraw heat map)
+};
+
+struct ShaderProgram {
+    unsigned int id = 0;
+    int uniforms[UNIFORM_COUNT]; // -1 for the ones the program lacks; glUniform*() ignores -1
+};
+
+// Binds made and binds skipped because the object was already bound
+struct GLStateStats {
+    unsigned long long programBinds = 0, programSkips = 0;
+    unsigned long long textureBinds = 0, textureSkips = 0;
+    unsigned long long vertexArrayBinds = 0, vertexArraySkips = 0;
+    unsigned long long blendChanges = 0, blendSkips = 0;
+};
+
+// Function declarations
+// Takes a linked program (0 is allowed and stays 0) and looks up every ShaderUniform in it
+void initShaderProgram(ShaderProgram& shader, unsigned int program);
+void destroyShaderProgram(ShaderProgram& shader);
+void useProgram(const ShaderProgram& shader);
+void bindTexture2D(unsigned int unit, unsigned int texture);
+void bindVertexArray(unsigned int vertexArray);
+void setBlendMode(BlendMode mode);
+// While on, every mode (BLEND_OFF too) adds instead, so the frame shows how often each pixel was drawn
+void setOverdrawView(bool enabled);
+// Forgets the shadowed bindings, so the next bind of each kind always goes to GL
+void resetGLState();
+// Counts since the last call
+GLStateStats takeGLStateStats();
+
+#endif
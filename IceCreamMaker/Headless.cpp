@@ -0,0 +1,156 @@
+// Runs the simulation without a window or GL context and prints what happened, for
+// profiling and reproducibility checks on machines without a display. Built by the
+// Makefile only; the Visual Studio project keeps Main.cpp as its single entry point.
+#include <iostream>
+#include <string>
+#include "Simulation.h"
+#include "Timing.h"
+
+// FNV-1a over raw bytes, so two runs can be compared bit for bit
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t simulationChecksum(const SimulationContext& simulation) {
+    const SprinkleStore& s = simulation.sprinkles.store;
+    const IceCreamState& iceCream = simulation.iceCream;
+    uint64_t hash = 14695981039346656037ULL;
+    if (!s.empty()) {
+        hash = hashBytes(hash, &s.x[0], s.count() * sizeof(float));
+        hash = hashBytes(hash, &s.y[0], s.count() * sizeof(float));
+        hash = hashBytes(hash, &s.state[0], s.count());
+        hash = hashBytes(hash, &s.colorIndex[0], s.count());
+    }
+    hash = hashBytes(hash, &iceCream.vanillaFill.fillLevel, sizeof(float));
+    hash = hashBytes(hash, &iceCream.chocolateFill.fillLevel, sizeof(float));
+    hash = hashBytes(hash, &iceCream.mixedFill.fillLevel, sizeof(float));
+    return hash;
+}
+
+static void printFill(const char* name, const CupFill& fill) {
+    std::cout << "  " << name << ": " << (fill.isFilled ? "filled" : "empty")
+        << ", level " << fill.fillLevel << std::endl;
+}
+
+int main(int argc, char** argv) {
+    // --seconds N: simulated time to run
+    // --sim-hz N: simulation steps per second
+    // --seed N: fixed seed for every sprinkle random stream (default 1, so runs repeat)
+    // --capacity N: live sprinkle pool size
+    // --pour vanilla|chocolate|mixed: pull that lever at the start; may be repeated
+    // --sprinkles: open the sprinkle lever at the start
+    // --bites N: take N spoonfuls, evenly spread over the second half of the run
+    // --exit-interval N: minimum time between two tunnel exits
+    double seconds = 10.0;
+    double simulationHz = 120.0;
+    uint64_t seed = 1;
+    size_t capacity = DEFAULT_SPRINKLE_CAPACITY;
+    bool pours[4] = { false, false, false, false };
+    bool sprinklesOpen = false;
+    int bites = 0;
+    float exitInterval = -1.0f;
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--seconds" && i + 1 < argc) {
+            seconds = std::stod(argv[++i]);
+        }
+        else if (option == "--sim-hz" && i + 1 < argc) {
+            simulationHz = std::stod(argv[++i]);
+        }
+        else if (option == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        }
+        else if (option == "--capacity" && i + 1 < argc) {
+            capacity = std::stoul(argv[++i]);
+        }
+        else if (option == "--pour" && i + 1 < argc) {
+            std::string flavor = argv[++i];
+            if (flavor == "vanilla") pours[1] = true;
+            else if (flavor == "chocolate") pours[2] = true;
+            else if (flavor == "mixed") pours[3] = true;
+            else {
+                std::cout << "Unknown flavor: " << flavor << std::endl;
+                return 1;
+            }
+        }
+        else if (option == "--sprinkles") {
+            sprinklesOpen = true;
+        }
+        else if (option == "--bites" && i + 1 < argc) {
+            bites = std::stoi(argv[++i]);
+        }
+        else if (option == "--exit-interval" && i + 1 < argc) {
+            exitInterval = std::stof(argv[++i]);
+        }
+        else {
+            std::cout << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+    if (simulationHz <= 0.0 || seconds < 0.0) {
+        std::cout << "--sim-hz must be positive and --seconds not negative" << std::endl;
+        return 1;
+    }
+
+    SimulationContext simulation;
+    initSimulation(simulation, capacity);
+    seedSprinkles(simulation.sprinkles, seed);
+    if (exitInterval >= 0.0f) simulation.sprinkles.tunnelExitInterval = exitInterval;
+    for (int flavorType = 1; flavorType <= 3; flavorType++) {
+        if (pours[flavorType]) toggleFlavor(simulation, flavorType);
+    }
+    if (sprinklesOpen) toggleSprinkles(simulation);
+
+    const double stepSize = 1.0 / simulationHz;
+    const unsigned long long steps = (unsigned long long)(seconds * simulationHz + 0.5);
+    // Spoonfuls land in the middle of the cup, just above its bottom
+    const float BITE_X = 0.3f;
+    const float BITE_Y = CUP_BOTTOM_POS_Y + 0.02f;
+    int bitesTaken = 0, bitesLanded = 0;
+    unsigned long long bakedSprinkles = 0;
+
+    double startTime = timingNow();
+    for (unsigned long long step = 0; step < steps; step++) {
+        updateSimulation(simulation, stepSize);
+
+        // Nothing bakes the settled sprinkles here, so count them the way the toppings layer would
+        bakedSprinkles += simulation.sprinkles.settled.size();
+        simulation.sprinkles.settled.clear();
+
+        if (bitesTaken < bites && step + 1 >= steps / 2 + (steps - steps / 2) * (bitesTaken + 1) / (bites + 1)) {
+            if (biteAt(simulation, BITE_X, BITE_Y)) bitesLanded++;
+            bitesTaken++;
+        }
+    }
+    double elapsed = timingNow() - startTime;
+
+    const SprinkleStore& s = simulation.sprinkles.store;
+    size_t stateCounts[4] = { 0, 0, 0, 0 };
+    for (size_t i = 0; i < s.count(); i++) {
+        if (s.state[i] < 4) stateCounts[s.state[i]]++;
+    }
+    TunnelStats tunnel = getTunnelStats(simulation.sprinkles);
+
+    std::cout << "Steps: " << steps << " at " << simulationHz << " Hz, "
+        << (steps > 0 ? elapsed * 1000.0 / steps : 0.0) << " ms/step" << std::endl;
+    std::cout << "Sprinkles: " << s.count() << " live (" << stateCounts[SPRINKLE_FALLING] << " falling, "
+        << stateCounts[SPRINKLE_IN_TUNNEL] << " in tunnel, " << stateCounts[SPRINKLE_DROPPING]
+        << " falling from tunnel, " << stateCounts[SPRINKLE_SETTLED] << " settled), "
+        << bakedSprinkles << " baked" << std::endl;
+    std::cout << "Sprinkle tunnel: " << tunnel.exits << " exits, max queue depth " << tunnel.maxQueueDepth
+        << ", average extra wait "
+        << (tunnel.exits > 0 ? tunnel.totalWaitTime * 1000.0 / tunnel.exits : 0.0) << " ms" << std::endl;
+    std::cout << "Bites: " << bitesLanded << " of " << bitesTaken << " landed, "
+        << simulation.biteMarks.size() << " marks left" << std::endl;
+    std::cout << "Cup:" << std::endl;
+    printFill("vanilla", simulation.iceCream.vanillaFill);
+    printFill("chocolate", simulation.iceCream.chocolateFill);
+    printFill("mixed", simulation.iceCream.mixedFill);
+    std::cout << "Checksum: " << std::hex << simulationChecksum(simulation) << std::dec << std::endl;
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include "Hull.h"
+#include "DrawList.h"
+#include <algorithm>
+#include <cmath>
+
+// Constants
+const int HULL_CELL_SIZE = 16;
+const int HULL_TILE_SIZE = 32;
+// Texels a sample inside a cell can reach beyond it: the bilinear neighbours at level 0 and 1,
+// and the 4x4 BC3 block it falls in
+static const int HULL_SAMPLE_REACH = 4;
+
+enum CellKind : unsigned char {
+    CELL_EMPTY,
+    CELL_TRANSLUCENT,
+    CELL_OPAQUE
+};
+
+// Merges runs of kind along each row, then stacks runs that span the same columns in
+// consecutive rows; rectangles come out in 0..1 of a columns x rows grid of cellWidth x
+// cellHeight cells clipped to width x height
+static void mergeCells(const std::vector<unsigned char>& cells, int columns, int rows, CellKind kind,
+    float cellWidth, float cellHeight, float width, float height, std::vector<HullRect>& rects) {
+    struct Run {
+        int x0, x1, y0, y1;
+    };
+    std::vector<Run> open, current;
+    auto emit = [&](const Run& run) {
+        rects.push_back({ run.x0 * cellWidth / width, run.y0 * cellHeight / height,
+            std::min(run.x1 * cellWidth, width) / width, std::min(run.y1 * cellHeight, height) / height });
+    };
+    for (int y = 0; y <= rows; y++) {
+        current.clear();
+        for (int x = 0; y < rows && x < columns;) {
+            if (cells[(size_t)y * columns + x] != kind) {
+                x++;
+                continue;
+            }
+            int start = x;
+            while (x < columns && cells[(size_t)y * columns + x] == kind) x++;
+            current.push_back({ start, x, y, y + 1 });
+        }
+        // A run continues an open rectangle when it covers exactly the same columns
+        for (Run& run : current) {
+            auto match = std::find_if(open.begin(), open.end(),
+                [&](const Run& o) { return o.x0 == run.x0 && o.x1 == run.x1; });
+            if (match != open.end()) {
+                run.y0 = match->y0;
+                open.erase(match);
+            }
+        }
+        for (const Run& run : open) emit(run);
+        open.swap(current);
+    }
+}
+
+void buildSpriteHull(const unsigned char* rgba, int width, int height, SpriteHull& hull) {
+    hull.opaque.clear();
+    hull.translucent.clear();
+    if (width <= 0 || height <= 0) return;
+
+    // Alpha range of every HULL_SAMPLE_REACH block first, so each cell only looks at a few blocks
+    const int block = HULL_SAMPLE_REACH;
+    int blockColumns = (width + block - 1) / block, blockRows = (height + block - 1) / block;
+    std::vector<unsigned char> blockMin((size_t)blockColumns * blockRows, 255);
+    std::vector<unsigned char> blockMax((size_t)blockColumns * blockRows, 0);
+    for (int y = 0; y < height; y++) {
+        const unsigned char* row = rgba + (size_t)y * width * 4;
+        for (int x = 0; x < width; x++) {
+            size_t b = (size_t)(y / block) * blockColumns + x / block;
+            unsigned char alpha = row[x * 4 + 3];
+            blockMin[b] = std::min(blockMin[b], alpha);
+            blockMax[b] = std::max(blockMax[b], alpha);
+        }
+    }
+    // Partial blocks on the right and top edge are followed by transparent atlas spacing
+    if (width % block != 0) for (int y = 0; y < blockRows; y++) blockMin[(size_t)y * blockColumns + blockColumns - 1] = 0;
+    if (height % block != 0) for (int x = 0; x < blockColumns; x++) blockMin[(size_t)(blockRows - 1) * blockColumns + x] = 0;
+
+    const int blocksPerCell = HULL_CELL_SIZE / block;
+    int columns = (width + HULL_CELL_SIZE - 1) / HULL_CELL_SIZE, rows = (height + HULL_CELL_SIZE - 1) / HULL_CELL_SIZE;
+    std::vector<unsigned char> cells((size_t)columns * rows);
+    for (int cy = 0; cy < rows; cy++) {
+        for (int cx = 0; cx < columns; cx++) {
+            // The cell grown by one block on every side; anything outside the image is transparent
+            unsigned char low = 255, high = 0;
+            for (int by = cy * blocksPerCell - 1; by <= (cy + 1) * blocksPerCell; by++) {
+                for (int bx = cx * blocksPerCell - 1; bx <= (cx + 1) * blocksPerCell; bx++) {
+                    if (bx < 0 || by < 0 || bx >= blockColumns || by >= blockRows) {
+                        low = 0;
+                        continue;
+                    }
+                    size_t b = (size_t)by * blockColumns + bx;
+                    low = std::min(low, blockMin[b]);
+                    high = std::max(high, blockMax[b]);
+                }
+            }
+            cells[(size_t)cy * columns + cx] = high == 0 ? CELL_EMPTY : low == 255 ? CELL_OPAQUE : CELL_TRANSLUCENT;
+        }
+    }
+    mergeCells(cells, columns, rows, CELL_OPAQUE, (float)HULL_CELL_SIZE, (float)HULL_CELL_SIZE,
+        (float)width, (float)height, hull.opaque);
+    mergeCells(cells, columns, rows, CELL_TRANSLUCENT, (float)HULL_CELL_SIZE, (float)HULL_CELL_SIZE,
+        (float)width, (float)height, hull.translucent);
+}
+
+void buildLayerHull(const DrawList& list, size_t firstCommand, size_t commandCount,
+    int width, int height, SpriteHull& hull) {
+    hull.opaque.clear();
+    hull.translucent.clear();
+    int columns = (width + HULL_TILE_SIZE - 1) / HULL_TILE_SIZE, rows = (height + HULL_TILE_SIZE - 1) / HULL_TILE_SIZE;
+    std::vector<unsigned char> tiles((size_t)columns * rows, CELL_EMPTY);
+
+    // Every tile a piece touches (plus a pixel for filtering) has something in it; only tiles
+    // wholly inside an opaque piece (less a pixel) are opaque in the composite
+    auto markPiece = [&](float left, float bottom, float right, float top, bool opaque) {
+        float x0 = (left + 1.0f) * 0.5f * width, x1 = (right + 1.0f) * 0.5f * width;
+        float y0 = (bottom + 1.0f) * 0.5f * height, y1 = (top + 1.0f) * 0.5f * height;
+        int tx0 = std::max(0, (int)std::floor((x0 - 1.0f) / HULL_TILE_SIZE));
+        int tx1 = std::min(columns, (int)std::ceil((x1 + 1.0f) / HULL_TILE_SIZE));
+        int ty0 = std::max(0, (int)std::floor((y0 - 1.0f) / HULL_TILE_SIZE));
+        int ty1 = std::min(rows, (int)std::ceil((y1 + 1.0f) / HULL_TILE_SIZE));
+        for (int ty = ty0; ty < ty1; ty++) {
+            for (int tx = tx0; tx < tx1; tx++) {
+                unsigned char& tile = tiles[(size_t)ty * columns + tx];
+                bool inside = opaque && tx * HULL_TILE_SIZE >= x0 + 1.0f && ty * HULL_TILE_SIZE >= y0 + 1.0f &&
+                    std::min((tx + 1) * HULL_TILE_SIZE, width) <= x1 - 1.0f &&
+                    std::min((ty + 1) * HULL_TILE_SIZE, height) <= y1 - 1.0f;
+                if (inside) tile = CELL_OPAQUE;
+                else if (tile == CELL_EMPTY) tile = CELL_TRANSLUCENT;
+            }
+        }
+    };
+    for (size_t c = firstCommand; c < firstCommand + commandCount; c++) {
+        const DrawCommand& command = list.commands[c];
+        for (size_t i = command.first; i < command.first + command.count; i++) {
+            const SpriteQuad& quad = list.quads[i];
+            if (!quad.hull) {
+                markPiece(quad.left, quad.bottom, quad.right, quad.top, false);
+                continue;
+            }
+            float quadWidth = quad.right - quad.left, quadHeight = quad.top - quad.bottom;
+            for (int kind = 0; kind < 2; kind++) {
+                const std::vector<HullRect>& rects = kind == 0 ? quad.hull->opaque : quad.hull->translucent;
+                for (const HullRect& r : rects) {
+                    markPiece(quad.left + r.x0 * quadWidth, quad.bottom + r.y0 * quadHeight,
+                        quad.left + r.x1 * quadWidth, quad.bottom + r.y1 * quadHeight, kind == 0);
+                }
+            }
+        }
+    }
+    mergeCells(tiles, columns, rows, CELL_OPAQUE, (float)HULL_TILE_SIZE, (float)HULL_TILE_SIZE,
+        (float)width, (float)height, hull.opaque);
+    mergeCells(tiles, columns, rows, CELL_TRANSLUCENT, (float)HULL_TILE_SIZE, (float)HULL_TILE_SIZE,
+        (float)width, (float)height, hull.translucent);
+}
+
+bool isHullEmpty(const SpriteHull& hull) {
+    return hull.opaque.empty() && hull.translucent.empty();
+}
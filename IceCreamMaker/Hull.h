@@ -0,0 +1,39 @@
+#ifndef HULL_H
+#define HULL_H
+
+// Tight meshes for mostly transparent layer images. The image is cut into cells that are
+// dropped when nothing visible can be sampled in them, drawn without blending when every texel
+// they can sample is opaque, and blended only on the translucent fringe in between. Neighbouring
+// cells of the same kind are merged into as few rectangles as possible.
+
+#include <cstddef>
+#include <vector>
+
+struct DrawList;
+
+// A rectangle in 0..1 across whatever it belongs to (x to the right, y up)
+struct HullRect {
+    float x0, y0, x1, y1;
+};
+
+struct SpriteHull {
+    std::vector<HullRect> opaque;
+    std::vector<HullRect> translucent;
+};
+
+// Constants
+extern const int HULL_CELL_SIZE;   // Image pixels per cell side
+extern const int HULL_TILE_SIZE;   // Screen pixels per tile side, for composited layers
+
+// Function declarations
+// From an RGBA image, bottom row first. Cells next to translucent texels stay translucent, so
+// bilinear and mipmapped samples inside an opaque rectangle only ever see alpha 255, as long
+// as the image's 4x4 blocks line up with the texture's (the atlas starts every image on one).
+void buildSpriteHull(const unsigned char* rgba, int width, int height, SpriteHull& hull);
+// The hull of a composited layer (commands [firstCommand, firstCommand + commandCount) of the
+// list, sprites only) on a width x height screen, from the hulls of its sprites
+void buildLayerHull(const DrawList& list, size_t firstCommand, size_t commandCount,
+    int width, int height, SpriteHull& hull);
+bool isHullEmpty(const SpriteHull& hull);
+
+#endif
@@ -1,34 +1,25 @@
 #include "IceCream.h"
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
-#include <iostream>
 #include <algorithm>
 
-// Global variables
-std::vector<IceCreamDrop> iceCreamDrops;
-CupFill vanillaFill;
-CupFill chocolateFill;
-CupFill mixedFill;
-bool vanillaPourActive = false;
-bool chocolatePourActive = false;
-bool mixedPourActive = false;
-
 // Constants
 const float NOZZLE_POS_Y = 0.2f;
 const float CUP_TOP_POS_Y = -0.5f;
 const float CUP_BOTTOM_POS_Y = -0.54f;
 const float GRAVITY = 0.5f;
 const float DROP_SPAWN_RATE = 0.2f;
+const float FILL_PER_SECOND = 0.1f; // How fast a running pour raises its layer
 const float DROP_WIDTH = 1.0f;
 const float CUP_FILL_WIDTH = 1.0f;
 
-// Local timers
-static float timeSinceVanillaDrop = 0.0f;
-static float timeSinceChocolateDrop = 0.0f;
-static float timeSinceMixedDrop = 0.0f;
+// Each drop carries one spawn interval's worth of fill, so the pour speed doesn't depend on the drop rate
+static const float FILL_PER_DROP = FILL_PER_SECOND * DROP_SPAWN_RATE;
+
+void initIceCream(IceCreamState& iceCream) {
+    CupFill& vanillaFill = iceCream.vanillaFill;
+    CupFill& chocolateFill = iceCream.chocolateFill;
+    CupFill& mixedFill = iceCream.mixedFill;
 
-void initIceCream() {
-    iceCreamDrops.clear();
+    iceCream.drops.clear();
     vanillaFill.fillLevel = CUP_BOTTOM_POS_Y;
     vanillaFill.isFilled = false;
     vanillaFill.isActive = false;
@@ -39,56 +30,62 @@ void initIceCream() {
     mixedFill.isFilled = false;
     mixedFill.isActive = false;
 
-    timeSinceVanillaDrop = 0.0f;
-    timeSinceChocolateDrop = 0.0f;
-    timeSinceMixedDrop = 0.0f;
+    iceCream.timeSinceVanillaDrop = 0.0f;
+    iceCream.timeSinceChocolateDrop = 0.0f;
+    iceCream.timeSinceMixedDrop = 0.0f;
 }
 
-void resetCup() {
-    initIceCream(); // Reset everything
+void resetCup(IceCreamState& iceCream) {
+    initIceCream(iceCream); // Reset everything
 }
 
-void spawnIceCreamDrop(int flavorType) {
+void spawnIceCreamDrop(IceCreamState& iceCream, int flavorType) {
     IceCreamDrop drop;
     drop.posY = NOZZLE_POS_Y;
+    drop.prevPosY = NOZZLE_POS_Y;
     drop.velocity = 0.0f;
     drop.height = 1.0f;
     drop.active = true;
     drop.lifeTime = 0.0f;
     drop.flavorType = flavorType;
-    iceCreamDrops.push_back(drop);
+    iceCream.drops.push_back(drop);
 }
 
-void updateIceCreamDrops(float deltaTime) {
+bool updateIceCreamDrops(IceCreamState& iceCream, float deltaTime) {
+    CupFill& vanillaFill = iceCream.vanillaFill;
+    CupFill& chocolateFill = iceCream.chocolateFill;
+    CupFill& mixedFill = iceCream.mixedFill;
+
     // Update separate timers for each flavor
-    if (vanillaPourActive) {
-        timeSinceVanillaDrop += deltaTime;
-        while (timeSinceVanillaDrop >= DROP_SPAWN_RATE) {
-            spawnIceCreamDrop(1); // Vanilla
-            timeSinceVanillaDrop -= DROP_SPAWN_RATE;
+    if (iceCream.vanillaPourActive) {
+        iceCream.timeSinceVanillaDrop += deltaTime;
+        while (iceCream.timeSinceVanillaDrop >= DROP_SPAWN_RATE) {
+            spawnIceCreamDrop(iceCream, 1); // Vanilla
+            iceCream.timeSinceVanillaDrop -= DROP_SPAWN_RATE;
         }
     }
 
-    if (chocolatePourActive) {
-        timeSinceChocolateDrop += deltaTime;
-        while (timeSinceChocolateDrop >= DROP_SPAWN_RATE) {
-            spawnIceCreamDrop(2); // Chocolate
-            timeSinceChocolateDrop -= DROP_SPAWN_RATE;
+    if (iceCream.chocolatePourActive) {
+        iceCream.timeSinceChocolateDrop += deltaTime;
+        while (iceCream.timeSinceChocolateDrop >= DROP_SPAWN_RATE) {
+            spawnIceCreamDrop(iceCream, 2); // Chocolate
+            iceCream.timeSinceChocolateDrop -= DROP_SPAWN_RATE;
         }
     }
 
-    if (mixedPourActive) {
-        timeSinceMixedDrop += deltaTime;
-        while (timeSinceMixedDrop >= DROP_SPAWN_RATE) {
-            spawnIceCreamDrop(3); // Mixed
-            timeSinceMixedDrop -= DROP_SPAWN_RATE;
+    if (iceCream.mixedPourActive) {
+        iceCream.timeSinceMixedDrop += deltaTime;
+        while (iceCream.timeSinceMixedDrop >= DROP_SPAWN_RATE) {
+            spawnIceCreamDrop(iceCream, 3); // Mixed
+            iceCream.timeSinceMixedDrop -= DROP_SPAWN_RATE;
         }
     }
 
     // Update all active drops
-    for (auto& drop : iceCreamDrops) {
+    for (auto& drop : iceCream.drops) {
         if (drop.active) {
             drop.lifeTime += deltaTime;
+            drop.prevPosY = drop.posY;
 
             // Apply gravity
             drop.velocity -= GRAVITY * deltaTime;
@@ -99,19 +96,19 @@ void updateIceCreamDrops(float deltaTime) {
 
                 switch (drop.flavorType) {
                 case 1: // Vanilla
-                    vanillaFill.fillLevel += 0.02f;
+                    vanillaFill.fillLevel += FILL_PER_DROP;
                     if (vanillaFill.fillLevel > CUP_TOP_POS_Y + 0.8f) {
                         vanillaFill.fillLevel = CUP_TOP_POS_Y + 0.8f;
                     }
                     break;
                 case 2: // Chocolate
-                    chocolateFill.fillLevel += 0.02f;
+                    chocolateFill.fillLevel += FILL_PER_DROP;
                     if (chocolateFill.fillLevel > CUP_TOP_POS_Y + 0.8f) {
                         chocolateFill.fillLevel = CUP_TOP_POS_Y + 0.8f;
                     }
                     break;
                 case 3: // Mixed
-                    mixedFill.fillLevel += 0.02f;
+                    mixedFill.fillLevel += FILL_PER_DROP;
                     if (mixedFill.fillLevel > CUP_TOP_POS_Y + 0.8f) {
                         mixedFill.fillLevel = CUP_TOP_POS_Y + 0.8f;
                     }
@@ -135,31 +132,31 @@ void updateIceCreamDrops(float deltaTime) {
     }
 
     // Clean up inactive drops
-    iceCreamDrops.erase(
-        std::remove_if(iceCreamDrops.begin(), iceCreamDrops.end(),
+    iceCream.drops.erase(
+        std::remove_if(iceCream.drops.begin(), iceCream.drops.end(),
             [](const IceCreamDrop& drop) { return !drop.active; }),
-        iceCreamDrops.end()
+        iceCream.drops.end()
     );
+    return !iceCream.drops.empty() || iceCream.vanillaPourActive || iceCream.chocolatePourActive ||
+        iceCream.mixedPourActive;
 }
 
-void handleIceCreamKeyPress(int key, int action) {
-    if (action == GLFW_PRESS) {
-        switch (key) {
-        case GLFW_KEY_1:
-            vanillaPourActive = !vanillaPourActive;
-            vanillaFill.isActive = vanillaPourActive;
-            vanillaFill.isFilled = true;
-            break;
-        case GLFW_KEY_2:
-            chocolatePourActive = !chocolatePourActive;
-            chocolateFill.isActive = chocolatePourActive;
-            chocolateFill.isFilled = true;
-            break;
-        case GLFW_KEY_SPACE:
-            mixedPourActive = !mixedPourActive;
-            mixedFill.isActive = mixedPourActive;
-            mixedFill.isFilled = true;
-            break;
-        }
+void toggleIceCreamPour(IceCreamState& iceCream, int flavorType) {
+    switch (flavorType) {
+    case 1: // Vanilla
+        iceCream.vanillaPourActive = !iceCream.vanillaPourActive;
+        iceCream.vanillaFill.isActive = iceCream.vanillaPourActive;
+        iceCream.vanillaFill.isFilled = true;
+        break;
+    case 2: // Chocolate
+        iceCream.chocolatePourActive = !iceCream.chocolatePourActive;
+        iceCream.chocolateFill.isActive = iceCream.chocolatePourActive;
+        iceCream.chocolateFill.isFilled = true;
+        break;
+    case 3: // Mixed
+        iceCream.mixedPourActive = !iceCream.mixedPourActive;
+        iceCream.mixedFill.isActive = iceCream.mixedPourActive;
+        iceCream.mixedFill.isFilled = true;
+        break;
     }
 }
\ No newline at end of file
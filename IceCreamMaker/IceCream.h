@@ -5,6 +5,7 @@
 
 struct IceCreamDrop {
     float posY = 0.0f;
+    float prevPosY = 0.0f; // posY at the start of the last simulation step
     float velocity = 0.0f;
     float height = 0.1f;
     bool active = false;
@@ -18,14 +19,19 @@ struct CupFill {
     bool isActive = false;
 };
 
-// Global variables
-extern std::vector<IceCreamDrop> iceCreamDrops;
-extern CupFill vanillaFill;
-extern CupFill chocolateFill;
-extern CupFill mixedFill;
-extern bool vanillaPourActive;
-extern bool chocolatePourActive;
-extern bool mixedPourActive;
+// Everything the pours and the cup fills need between steps
+struct IceCreamState {
+    std::vector<IceCreamDrop> drops;
+    CupFill vanillaFill;
+    CupFill chocolateFill;
+    CupFill mixedFill;
+    bool vanillaPourActive = false;
+    bool chocolatePourActive = false;
+    bool mixedPourActive = false;
+    float timeSinceVanillaDrop = 0.0f;
+    float timeSinceChocolateDrop = 0.0f;
+    float timeSinceMixedDrop = 0.0f;
+};
 
 // Constants
 extern const float NOZZLE_POS_Y;
@@ -33,14 +39,17 @@ extern const float CUP_TOP_POS_Y;
 extern const float CUP_BOTTOM_POS_Y;
 extern const float GRAVITY;
 extern const float DROP_SPAWN_RATE;
+extern const float FILL_PER_SECOND;
 extern const float DROP_WIDTH;
 extern const float CUP_FILL_WIDTH;
 
 // Function declarations
-void initIceCream();
-void resetCup();
-void spawnIceCreamDrop(int flavorType);
-void updateIceCreamDrops(float deltaTime);
-void handleIceCreamKeyPress(int key, int action);
+void initIceCream(IceCreamState& iceCream);
+void resetCup(IceCreamState& iceCream);
+void spawnIceCreamDrop(IceCreamState& iceCream, int flavorType);
+// Returns whether anything is still pouring or falling
+bool updateIceCreamDrops(IceCreamState& iceCream, float deltaTime);
+// Starts or stops the pour of flavorType (1=vanilla, 2=chocolate, 3=mixed)
+void toggleIceCreamPour(IceCreamState& iceCream, int flavorType);
 
 #endif
\ No newline at end of file
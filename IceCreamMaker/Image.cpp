@@ -0,0 +1,106 @@
+#include "Image.h"
+#include "AssetPack.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Pronalazi najmanji pravougaonik koji sadrzi sve neprovidne piksele, prosiren za jedan
+// piksel kako bi bilinearno filtriranje i dalje utapalo ivice u providnost
+void findVisibleBounds(const unsigned char* data, int width, int height, int channels,
+    int& x0, int& y0, int& x1, int& y1)
+{
+    x0 = 0; y0 = 0; x1 = width; y1 = height;
+    if (channels != 4) return; // Bez alfa kanala je cijela slika vidljiva
+
+    int minX = width, minY = height, maxX = -1, maxY = -1;
+    for (int y = 0; y < height; y++) {
+        const unsigned char* row = data + (size_t)y * width * 4;
+        int rowMin = -1, rowMax = -1;
+        for (int x = 0; x < width; x++) {
+            if (row[x * 4 + 3] != 0) { rowMin = x; break; }
+        }
+        if (rowMin < 0) continue;
+        for (int x = width - 1; x >= rowMin; x--) {
+            if (row[x * 4 + 3] != 0) { rowMax = x; break; }
+        }
+        if (rowMin < minX) minX = rowMin;
+        if (rowMax > maxX) maxX = rowMax;
+        if (y < minY) minY = y;
+        maxY = y;
+    }
+
+    if (maxX < 0) {
+        // Potpuno providna slika - dovoljan je jedan piksel
+        x1 = 1; y1 = 1;
+        return;
+    }
+    x0 = minX > 0 ? minX - 1 : 0;
+    y0 = minY > 0 ? minY - 1 : 0;
+    x1 = maxX + 1 < width ? maxX + 2 : width;
+    y1 = maxY + 1 < height ? maxY + 2 : height;
+}
+
+// Pravougaonik u lokalnim koordinatama quad-a [-1, 1] koji pokriva cijelo platno
+TextureRect boundsToRect(int width, int height, int x0, int y0, int x1, int y1)
+{
+    TextureRect rect;
+    rect.offsetX = (float)(x0 + x1) / width - 1.0f;
+    rect.offsetY = (float)(y0 + y1) / height - 1.0f;
+    rect.scaleX = (float)(x1 - x0) / width;
+    rect.scaleY = (float)(y1 - y0) / height;
+    return rect;
+}
+
+void flipImageRows(unsigned char* data, int width, int height, int channels) {
+    stbi__vertical_flip(data, width, height, channels);
+}
+
+bool loadTrimmedImage(const char* filePath, TrimmedImage& image) {
+    int TextureWidth;
+    int TextureHeight;
+    int TextureChannels;
+    // Slika dolazi iz paketa resursa bez kopiranja, ili se cita sa diska
+    AssetSpan file;
+    std::vector<unsigned char> storage;
+    unsigned char* ImageData = NULL;
+    // Uvijek trazimo RGBA kako bi sve slike mogle dijeliti isti atlas
+    if (loadAsset(filePath, file, storage)) {
+        ImageData = stbi_load_from_memory(file.data, (int)file.size, &TextureWidth, &TextureHeight, &TextureChannels, 4);
+    }
+    if (ImageData == NULL)
+    {
+        std::cout << "Slika nije ucitana! Putanja slike: " << filePath << std::endl;
+        return false;
+    }
+    flipImageRows(ImageData, TextureWidth, TextureHeight, 4);
+
+    int x0, y0, x1, y1;
+    findVisibleBounds(ImageData, TextureWidth, TextureHeight, 4, x0, y0, x1, y1);
+    image.rect = boundsToRect(TextureWidth, TextureHeight, x0, y0, x1, y1);
+
+    // Kopira se samo vidljivi dio, cijelo platno se odmah oslobadja
+    image.width = x1 - x0;
+    image.height = y1 - y0;
+    image.pixels.resize((size_t)image.width * image.height * 4);
+    for (int y = 0; y < image.height; y++) {
+        memcpy(&image.pixels[(size_t)y * image.width * 4],
+            ImageData + ((size_t)(y0 + y) * TextureWidth + x0) * 4,
+            (size_t)image.width * 4);
+    }
+    stbi_image_free(ImageData);
+    return true;
+}
+
+bool writePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "Failed to write " << path << std::endl;
+        return false;
+    }
+    file << "P6\n" << width << " " << height << "\n255\n";
+    file.write((const char*)pixels.data(), pixels.size());
+    return (bool)file;
+}
@@ -0,0 +1,32 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <vector>
+#include <string>
+
+// Visible part of a full-canvas image, expressed as the translation/scale that maps
+// the [-1, 1] quad onto it (identity when the whole canvas is visible)
+struct TextureRect {
+    float offsetX = 0.0f, offsetY = 0.0f;
+    float scaleX = 1.0f, scaleY = 1.0f;
+};
+
+// Decoded RGBA image already cut down to its visible part (bottom row first, like GL expects)
+struct TrimmedImage {
+    int width = 0, height = 0;
+    std::vector<unsigned char> pixels;
+    TextureRect rect;
+};
+
+// Function declarations
+// Smallest rectangle holding every non-transparent pixel, grown by one pixel for filtering
+void findVisibleBounds(const unsigned char* data, int width, int height, int channels,
+    int& x0, int& y0, int& x1, int& y1);
+TextureRect boundsToRect(int width, int height, int x0, int y0, int x1, int y1);
+// stb_image decodes top row first; GL and the atlas want the bottom row first
+void flipImageRows(unsigned char* data, int width, int height, int channels);
+bool loadTrimmedImage(const char* filePath, TrimmedImage& image);
+// Binary PPM (P6) from tightly packed RGB rows, top row first
+bool writePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels);
+
+#endif
@@ -0,0 +1,176 @@
+#include "LayerCache.h"
+#include "Hull.h"
+#include "SpriteBatch.h"
+#include <GL/glew.h>
+#include <cstdint>
+#include <iostream>
+
+struct LayerCache {
+    unsigned int framebuffer = 0;
+    unsigned int texture = 0;
+    unsigned int meshVAO = 0;
+    unsigned int meshVBO = 0;
+    int opaqueVertices = 0;      // The mesh holds the opaque part's triangles first,
+    int translucentVertices = 0; // then the translucent part's
+    uint64_t key = 0; // Hash of the quads the texture holds
+    bool valid = false;
+};
+
+static ShaderProgram layerShader;
+static std::vector<LayerCache> layers;
+static int viewportWidth = 0, viewportHeight = 0;
+static LayerCacheStats stats;
+
+void initLayerCaches(const ShaderProgram& rectShader, int layerCount, int screenWidth, int screenHeight) {
+    layerShader = rectShader;
+    viewportWidth = screenWidth;
+    viewportHeight = screenHeight;
+
+    layers.resize(layerCount);
+    for (LayerCache& layer : layers) {
+        // One texel per pixel, so the cache is copied to the screen exactly
+        glGenTextures(1, &layer.texture);
+        bindTexture2D(0, layer.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, screenWidth, screenHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        bindTexture2D(0, 0);
+
+        glGenFramebuffers(1, &layer.framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, layer.framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, layer.texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Layer cache framebuffer is incomplete" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // Filled in whenever the layer is redrawn
+        glGenVertexArrays(1, &layer.meshVAO);
+        glGenBuffers(1, &layer.meshVBO);
+        bindVertexArray(layer.meshVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, layer.meshVBO);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        bindVertexArray(0);
+    }
+}
+
+// Two triangles per rectangle; the texture spans the screen, so texture coordinates follow position
+static void appendRects(const std::vector<HullRect>& rects, std::vector<float>& vertices) {
+    for (const HullRect& r : rects) {
+        float corners[6][2] = { { r.x0, r.y1 }, { r.x0, r.y0 }, { r.x1, r.y0 }, { r.x0, r.y1 }, { r.x1, r.y0 }, { r.x1, r.y1 } };
+        for (const auto& corner : corners) {
+            vertices.push_back(corner[0] * 2.0f - 1.0f);
+            vertices.push_back(corner[1] * 2.0f - 1.0f);
+            vertices.push_back(corner[0]);
+            vertices.push_back(corner[1]);
+        }
+    }
+}
+
+static void rebuildLayerMesh(LayerCache& layer, const DrawList& list, size_t firstCommand, size_t commandCount) {
+    SpriteHull hull;
+    buildLayerHull(list, firstCommand, commandCount, viewportWidth, viewportHeight, hull);
+    std::vector<float> vertices;
+    appendRects(hull.opaque, vertices);
+    appendRects(hull.translucent, vertices);
+    layer.opaqueVertices = (int)hull.opaque.size() * 6;
+    layer.translucentVertices = (int)hull.translucent.size() * 6;
+    glBindBuffer(GL_ARRAY_BUFFER, layer.meshVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+}
+
+// FNV-1a over every quad of the layer's commands
+static uint64_t hashLayer(const DrawList& list, size_t firstCommand, size_t commandCount) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t c = firstCommand; c < firstCommand + commandCount; c++) {
+        const DrawCommand& command = list.commands[c];
+        const unsigned char* bytes = (const unsigned char*)&list.quads[command.first];
+        for (size_t i = 0; i < command.count * sizeof(SpriteQuad); i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        hash ^= command.count;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void redrawLayer(LayerCache& layer, const DrawList& list, size_t firstCommand, size_t commandCount) {
+    float clearColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    glBindFramebuffer(GL_FRAMEBUFFER, layer.framebuffer);
+    glViewport(0, 0, viewportWidth, viewportHeight);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    // Color is stored premultiplied and alpha accumulates coverage, so drawing the texture with
+    // BLEND_PREMULTIPLIED gives what drawing the sprites straight to the screen would
+    setBlendMode(BLEND_COMPOSITE);
+    for (size_t c = firstCommand; c < firstCommand + commandCount; c++) {
+        const DrawCommand& command = list.commands[c];
+        for (size_t i = command.first; i < command.first + command.count; i++) {
+            drawSpriteQuad(list.quads[i]);
+        }
+    }
+    flushSprites();
+    setBlendMode(BLEND_ALPHA);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+}
+
+void updateLayerCaches(const DrawList& list) {
+    for (size_t c = 0; c < list.commands.size(); c++) {
+        const DrawCommand& command = list.commands[c];
+        if (command.type != DRAW_LAYER || command.first >= layers.size()) continue;
+
+        LayerCache& layer = layers[command.first];
+        uint64_t key = hashLayer(list, c + 1, command.count);
+        if (!layer.valid || layer.key != key) {
+            redrawLayer(layer, list, c + 1, command.count);
+            rebuildLayerMesh(layer, list, c + 1, command.count);
+            layer.key = key;
+            layer.valid = true;
+            stats.redraws++;
+        }
+        c += command.count;
+    }
+}
+
+void drawLayerCache(int layer, LayerCachePart part, float depth) {
+    const LayerCache& cache = layers[layer];
+    int first = part == LAYER_PART_TRANSLUCENT ? cache.opaqueVertices : 0;
+    int count = part == LAYER_PART_OPAQUE ? cache.opaqueVertices :
+        part == LAYER_PART_TRANSLUCENT ? cache.translucentVertices : cache.opaqueVertices + cache.translucentVertices;
+    // The opaque part is drawn first when it is drawn on its own, so the layer counts once
+    if (part != LAYER_PART_OPAQUE) stats.draws++;
+    if (count == 0) return;
+
+    useProgram(layerShader);
+    glUniform2f(layerShader.uniforms[UNIFORM_TRANSLATION], 0.0f, 0.0f);
+    glUniform2f(layerShader.uniforms[UNIFORM_SCALE], 1.0f, 1.0f);
+    glUniform1f(layerShader.uniforms[UNIFORM_DEPTH], depth);
+    bindTexture2D(0, cache.texture);
+    bindVertexArray(cache.meshVAO);
+    setBlendMode(part == LAYER_PART_OPAQUE ? BLEND_OFF : BLEND_PREMULTIPLIED);
+    glDrawArrays(GL_TRIANGLES, first, count);
+}
+
+LayerCacheStats takeLayerCacheStats() {
+    LayerCacheStats taken = stats;
+    stats = LayerCacheStats();
+    return taken;
+}
+
+void destroyLayerCaches() {
+    for (LayerCache& layer : layers) {
+        glDeleteFramebuffers(1, &layer.framebuffer);
+        glDeleteTextures(1, &layer.texture);
+        glDeleteBuffers(1, &layer.meshVBO);
+        glDeleteVertexArrays(1, &layer.meshVAO);
+    }
+    layers.clear();
+}
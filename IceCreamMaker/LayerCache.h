@@ -0,0 +1,34 @@
+#ifndef LAYER_CACHE_H
+#define LAYER_CACHE_H
+
+// Offscreen copies of the draw list's DRAW_LAYER groups. Each layer is composited into its own
+// screen-sized texture and redrawn only when its sprite quads change (a fill level moves, the
+// sprinkle lever flips), so a frame draws one textured mesh per layer instead of all of its
+// overlapping sprites. The mesh covers only the tiles the layer's sprites reach, split into the
+// tiles they make opaque and the translucent rest.
+
+#include "DrawList.h"
+#include "GLState.h"
+
+enum LayerCachePart {
+    LAYER_PART_ALL,         // Everything, blended
+    LAYER_PART_OPAQUE,      // Tiles the layer covers completely, without blending
+    LAYER_PART_TRANSLUCENT  // The rest, blended
+};
+
+struct LayerCacheStats {
+    unsigned long long draws = 0;   // Layers drawn from their cache
+    unsigned long long redraws = 0; // Layers whose cache had to be redrawn first
+};
+
+// Function declarations
+void initLayerCaches(const ShaderProgram& rectShader, int layerCount, int screenWidth, int screenHeight);
+// Redraws every cached layer in the list whose quads changed; call before the frame starts drawing
+void updateLayerCaches(const DrawList& list);
+// Draws a layer updateLayerCaches() has seen this frame, at NDC z depth; sets the blend mode it needs
+void drawLayerCache(int layer, LayerCachePart part = LAYER_PART_ALL, float depth = 0.0f);
+// Counts since the last call
+LayerCacheStats takeLayerCacheStats();
+void destroyLayerCaches();
+
+#endif
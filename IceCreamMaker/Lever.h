@@ -2,19 +2,20 @@
 #define LEVER_H
 
 // Lever state variables
-extern bool vanilla;
-extern bool chocolate;
-extern bool mixed;
-extern float leverPositionVanilla;
-extern float leverPositionMixed;
-extern float leverPositionChocolate;
+struct LeverState {
+    bool vanilla = false;
+    bool chocolate = false;
+    bool mixed = false;
+    float leverPositionVanilla = 1.0f;
+    float leverPositionMixed = 1.0f;
+    float leverPositionChocolate = 1.0f;
+};
 
 // Constants
 extern const float leverSpeed;
 
 // Function declarations
-void updateLevers(float deltaTime);
-void drawIceCreamLever(int type, float leverPosition, unsigned int rectShader,
-    unsigned int VAO_leverVertical, unsigned int VAO_leverHorizontal);
+// Returns whether any lever moved
+bool updateLevers(LeverState& levers, float deltaTime);
 
 #endif
\ No newline at end of file
@@ -1,112 +1,160 @@
 ﻿#include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <string>
+#include <cstdio>
+#include <future>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include "Util.h"
-#include "Sprinkles.h"
-#include "IceCream.h"
-#include "Lever.h"
-
-// Texture IDs (keep as before)
-unsigned machineTexture;
-unsigned leverVerticalTexture;
-unsigned leverHorizontalTexture;
-unsigned sprinklesOpenTexture;
-unsigned sprinklesCloseTexture;
-unsigned iceCreamVanillaTexture;
-unsigned iceCreamChocolateTexture;
-unsigned iceCreamMixedTexture;
-unsigned vanillaPourTexture;
-unsigned chocolatePourTexture;
-unsigned mixedPourTexture;
-unsigned cupFrontTexture;
-unsigned cupBackTexture;
-unsigned spoonTexture;
-unsigned circularTexture;
-unsigned nameTexture;
-unsigned glassTexture;
-
-// Add these near your other global variables in main.cpp:
-bool vanillaFilled = false;
-float vanillaLevel = 0.0f;
-bool chocolateFilled = false;
-float chocolateLevel = 0.0f;
-bool mixedFilled = false;
-float mixedLevel = 0.0f;
-float cupBottomY = -0.5f;
+#include "Simulation.h"
+#include "Scene.h"
+#include "SprinkleRenderer.h"
+#include "SpriteBatch.h"
+#include "Toppings.h"
+#include "Timing.h"
+#include "Offscreen.h"
+#include "AssetPack.h"
+#include "GLState.h"
+#include "LayerCache.h"
+#include "QualityGovernor.h"
+#include "FrameSnapshot.h"
+
+// Layer images, all packed into one atlas texture
+SceneSprites sceneSprites;
+DrawList frameDrawList;
+bool layerCaching = true;
+// Opaque parts of the sprites are drawn first, front to back with depth writes, so the blended
+// parts behind them are rejected by the depth test instead of shaded
+bool hullSplit = true;
+bool overdrawView = false;
+// The scene (everything but the overlay) can be drawn at a fraction of the output resolution into
+// sceneTarget and scaled up with bilinear filtering; the cursor follows at full resolution
+float renderScale = 1.0f;
+OffscreenTarget sceneTarget;
+unsigned int upscaleVAO = 0;
+const float MIN_RENDER_SCALE = 0.25f;
+// --render-scale auto keeps the scene at about this many pixels (1080p) on larger outputs
+const double AUTO_RENDER_PIXELS = 1920.0 * 1080.0;
+// Windowed runs trade detail for frame time when the frames get too slow; see QualityGovernor.h
+QualityGovernor qualityGovernor;
+bool qualityGoverning = true;
+BiteMarkDetail biteMarkDetail = BITE_MARKS_FULL;
+// The scale frames are built for; the renderer switches when it sees a new one
+float renderScaleRequest = 1.0f;
+float appliedRenderScale = 1.0f;
+// Windowed runs draw on a thread of their own. The main thread polls input, steps the simulation
+// and publishes every frame as a FrameSnapshot; the render thread owns the GL context, draws the
+// newest snapshot and swaps, so a slow swap no longer holds up the simulation or the other way
+// round. The mutex only puts the render thread to sleep; the snapshots themselves pass without it.
+bool renderThreading = true;
+SnapshotBuffer frameSnapshots;
+std::thread renderThread;
+std::mutex renderWakeMutex;
+std::condition_variable renderWake;
+std::atomic<bool> renderThreadStop(false);
+std::atomic<unsigned long long> framesPresented(0);
+std::atomic<double> lastRenderWork(0.0); // Seconds the render thread's last frame took, up to its swap
 
 float spoonX = 0.0f, spoonY = 0.0f;
 float spoonSize = 0.2f;
 bool mousePressed = false;
 
-const double FPS = 75.0;
-double lastTimeForRefresh = 0.0;
-// Bite marks - now only store positions, we'll draw them differently
-struct BiteMark {
-    float x, y;
-    float size;
-};
-std::vector<BiteMark> biteMarks;
-
-unsigned int VAO_machine, VAO_leverVertical, VAO_leverHorizontal;
-unsigned int VAO_sprinklesLever, VAO_iceCreamVanilla, VAO_cup, VAO_spoon;
+FramePacer framePacer;
+const double FALLBACK_REFRESH_RATE = 75.0;
+const double PACING_REPORT_PERIOD = 5.0;
+const double HEADLESS_FPS = 60.0;
+// Once nothing has moved for IDLE_DELAY the loop stops drawing and waits for input, waking every
+// IDLE_WAIT_TIMEOUT to keep the pacing report going
+IdleTracker idleTracker;
+const double IDLE_DELAY = 0.25;
+const double IDLE_WAIT_TIMEOUT = 0.5;
 
 // Global variables
+SimulationContext simulation;
 double lastUpdateTime = 0.0;
+FixedStepClock simulationClock;
+const double DEFAULT_SIMULATION_HZ = 120.0;
+const int MAX_SIMULATION_STEPS_PER_FRAME = 8;
+
+// Startup stages, timed back to back and reported once the first frame is presented
+struct StartupStage {
+    const char* name;
+    double seconds;
+};
+std::vector<StartupStage> startupStages;
+double startupTime = 0.0;
+double startupStageStart = 0.0;
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    noteActivity(idleTracker);
     if (key == GLFW_KEY_S && action == GLFW_PRESS) {
-        sprinklesOpen = !sprinklesOpen;
+        toggleSprinkles(simulation);
     }
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, GLFW_TRUE); // Close the window
         return;
     }
     // Handle ice cream key presses
-    handleIceCreamKeyPress(key, action);
-    
-    // Update lever states (for animation)
     if (action == GLFW_PRESS) {
         switch (key) {
         case GLFW_KEY_1:
-            vanilla = !vanilla;
+            toggleFlavor(simulation, 1);
             break;
         case GLFW_KEY_2:
-            chocolate = !chocolate;
+            toggleFlavor(simulation, 2);
             break;
         case GLFW_KEY_SPACE:
-            mixed = !mixed;
+            toggleFlavor(simulation, 3);
             break;
         case GLFW_KEY_R:
-            resetCup();
-            biteMarks.clear();
-            resetSprinkles();
+            resetSimulation(simulation);
             break;
         }   
     }
 }
 
+void endStartupStage(const char* name) {
+    double now = timingNow();
+    startupStages.push_back({ name, now - startupStageStart });
+    startupStageStart = now;
+}
+
+void printStartupReport(double atlasPrepareSeconds) {
+    std::cout << "Startup:";
+    for (size_t i = 0; i < startupStages.size(); i++) {
+        std::cout << (i == 0 ? " " : ", ") << startupStages[i].name << " " << startupStages[i].seconds * 1000.0 << " ms";
+    }
+    std::cout << std::endl;
+    std::cout << "Startup: atlas prepared in " << atlasPrepareSeconds * 1000.0 << " ms in the background, first frame after "
+        << (timingNow() - startupTime) * 1000.0 << " ms" << std::endl;
+}
+
+void printPacingReport(double targetFps) {
+    FramePacingReport pacing;
+    if (!takeFramePacingReport(framePacer, PACING_REPORT_PERIOD, pacing)) return;
+    std::cout << "Pacing: " << pacing.fps << " fps (target " << targetFps << "), error "
+        << pacing.meanErrorMs << " ms avg / " << pacing.maxErrorMs << " ms max, jitter "
+        << pacing.jitterMs << " ms, CPU " << pacing.cpuPercent << "%, idle " << pacing.idlePercent << "%" << std::endl;
+}
+
 int endProgram(std::string message) {
     std::cout << message << std::endl;
     glfwTerminate();
     return -1;
 }
 
-void preprocessTexture(unsigned& texture, const char* filepath) {
-    texture = loadImageToTexture(filepath);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-}
-
 void formVAOs(float* verticesRect, size_t rectSize, unsigned int& VAOrect) {
     unsigned int VBOrect;
     glGenVertexArrays(1, &VAOrect);
     glGenBuffers(1, &VBOrect);
 
-    glBindVertexArray(VAOrect);
+    bindVertexArray(VAOrect);
     glBindBuffer(GL_ARRAY_BUFFER, VBOrect);
     glBufferData(GL_ARRAY_BUFFER, rectSize, verticesRect, GL_STATIC_DRAW);
 
@@ -116,55 +164,280 @@ void formVAOs(float* verticesRect, size_t rectSize, unsigned int& VAOrect) {
     glEnableVertexAttribArray(1);
 }
 
-void drawRect(unsigned int rectShader, unsigned int VAOrect, unsigned int textureID,
-    float posX = 0.0f, float posY = 0.0f, float scaleX = 1.0f, float scaleY = 1.0f) {
-    glUseProgram(rectShader);
+// Everything drawFrameSplit() gives a depth of its own: one sprite quad, or one whole command
+struct FrameItem {
+    DrawCommandType type;
+    size_t index; // Into quads for DRAW_SPRITES, into commands otherwise
+};
+std::vector<FrameItem> frameItems;
+
+// Draws commands [firstCommand, endCommand) in order, every sprite blended over the whole of its quad
+void drawFrameInOrder(const DrawList& list, size_t firstCommand, size_t endCommand,
+    const ShaderProgram& particleShader, unsigned int particleVAO) {
+    setBlendMode(BLEND_ALPHA);
+    for (size_t c = firstCommand; c < endCommand; c++) {
+        const DrawCommand& command = list.commands[c];
+        switch (command.type) {
+        case DRAW_SPRITES:
+            for (size_t i = command.first; i < command.first + command.count; i++) {
+                drawSpriteQuad(list.quads[i]);
+            }
+            // Sprinkles and toppings use their own shaders, so queued sprites have to go out first
+            flushSprites();
+            break;
+        case DRAW_SPRINKLES:
+            drawSprinkleInstances(particleShader, particleVAO, &list.sprinkles[command.first], command.count);
+            break;
+        case DRAW_TOPPINGS:
+            drawToppings();
+            break;
+        case DRAW_LAYER:
+            // Without the cache the layer's sprites simply follow as ordinary commands
+            if (layerCaching) {
+                drawLayerCache((int)command.first);
+                setBlendMode(BLEND_ALPHA);
+                c += command.count;
+            }
+            break;
+        }
+    }
+}
 
-    // Set uniforms
-    glUniform2f(glGetUniformLocation(rectShader, "uTranslation"), posX, posY);
-    glUniform2f(glGetUniformLocation(rectShader, "uScale"), scaleX, scaleY);
+// The same picture in two passes. Item k of n is drawn at z = 1 - (k + 1) * 2 / (n + 2), so later
+// items are nearer. The opaque pass goes front to back and writes depth; the blended pass goes
+// back to front and only tests it, so it skips whatever a later opaque part covers.
+void drawFrameSplit(const DrawList& list, size_t firstCommand, size_t endCommand,
+    const ShaderProgram& particleShader, unsigned int particleVAO) {
+    frameItems.clear();
+    for (size_t c = firstCommand; c < endCommand; c++) {
+        const DrawCommand& command = list.commands[c];
+        if (command.type == DRAW_SPRITES) {
+            for (size_t i = command.first; i < command.first + command.count; i++) frameItems.push_back({ DRAW_SPRITES, i });
+        }
+        else if (command.type != DRAW_LAYER || layerCaching) {
+            frameItems.push_back({ command.type, c });
+            if (command.type == DRAW_LAYER) c += command.count;
+        }
+    }
+    const float depthStep = 2.0f / (frameItems.size() + 2);
+    auto itemDepth = [&](size_t k) { return 1.0f - (k + 1) * depthStep; };
+
+    glEnable(GL_DEPTH_TEST);
+    // Equal depth only happens within one item: the sprinkles of a command, drawn in order
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_TRUE);
+    setBlendMode(BLEND_OFF);
+    for (size_t k = frameItems.size(); k-- > 0;) {
+        const FrameItem& item = frameItems[k];
+        if (item.type == DRAW_SPRITES) {
+            const SpriteQuad& quad = list.quads[item.index];
+            if (!quad.hull) continue;
+            for (const HullRect& part : quad.hull->opaque) drawSpriteQuadPart(quad, part, itemDepth(k));
+            continue;
+        }
+        flushSprites();
+        const DrawCommand& command = list.commands[item.index];
+        // Sprinkles are solid discs, so all of them belong to this pass
+        if (item.type == DRAW_SPRINKLES) {
+            drawSprinkleInstances(particleShader, particleVAO, &list.sprinkles[command.first], command.count, itemDepth(k));
+        }
+        else if (item.type == DRAW_LAYER) {
+            drawLayerCache((int)command.first, LAYER_PART_OPAQUE, itemDepth(k));
+            setBlendMode(BLEND_OFF);
+        }
+    }
+    flushSprites();
+
+    glDepthMask(GL_FALSE);
+    setBlendMode(BLEND_ALPHA);
+    for (size_t k = 0; k < frameItems.size(); k++) {
+        const FrameItem& item = frameItems[k];
+        if (item.type == DRAW_SPRITES) {
+            const SpriteQuad& quad = list.quads[item.index];
+            if (!quad.hull) drawSpriteQuad(quad, itemDepth(k));
+            else for (const HullRect& part : quad.hull->translucent) drawSpriteQuadPart(quad, part, itemDepth(k));
+            continue;
+        }
+        if (item.type == DRAW_SPRINKLES) continue;
+        flushSprites();
+        const DrawCommand& command = list.commands[item.index];
+        if (item.type == DRAW_TOPPINGS) {
+            drawToppings(itemDepth(k));
+        }
+        else if (item.type == DRAW_LAYER) {
+            drawLayerCache((int)command.first, LAYER_PART_TRANSLUCENT, itemDepth(k));
+            setBlendMode(BLEND_ALPHA);
+        }
+    }
+    flushSprites();
+    glDepthMask(GL_TRUE);
+    glDisable(GL_DEPTH_TEST);
+}
 
-    // Bind texture and draw
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glUniform1i(glGetUniformLocation(rectShader, "uTex"), 0);
+// Hands commands [firstCommand, endCommand) of one frame's draw list to GL
+void drawFrame(const DrawList& list, size_t firstCommand, size_t endCommand, const ShaderProgram& rectShader,
+    const ShaderProgram& particleShader, unsigned int particleVAO) {
+    // Only the frame itself shows up in the heat map, not the layers and toppings drawn for it
+    if (overdrawView) {
+        setOverdrawView(true);
+        useProgram(rectShader);
+        glUniform1f(rectShader.uniforms[UNIFORM_OVERDRAW], 1.0f);
+        useProgram(particleShader);
+        glUniform1f(particleShader.uniforms[UNIFORM_OVERDRAW], 1.0f);
+    }
+    if (hullSplit) drawFrameSplit(list, firstCommand, endCommand, particleShader, particleVAO);
+    else drawFrameInOrder(list, firstCommand, endCommand, particleShader, particleVAO);
+    if (overdrawView) {
+        useProgram(rectShader);
+        glUniform1f(rectShader.uniforms[UNIFORM_OVERDRAW], 0.0f);
+        useProgram(particleShader);
+        glUniform1f(particleShader.uniforms[UNIFORM_OVERDRAW], 0.0f);
+        setOverdrawView(false);
+        setBlendMode(BLEND_ALPHA);
+    }
+}
 
-    glBindVertexArray(VAOrect);
+// Sizes the scene target, and the layer caches that match it, for a new scale; at 1 the scene is
+// drawn straight to the output
+void applyRenderScale(float scale, int outputWidth, int outputHeight, const ShaderProgram& rectShader) {
+    scale = std::min(1.0f, std::max(MIN_RENDER_SCALE, scale));
+    if (sceneTarget.framebuffer != 0) destroyOffscreenTarget(sceneTarget);
+    int sceneWidth = outputWidth, sceneHeight = outputHeight;
+    if (scale < 1.0f) {
+        sceneWidth = std::max(1, (int)(outputWidth * scale + 0.5f));
+        sceneHeight = std::max(1, (int)(outputHeight * scale + 0.5f));
+        if (!initOffscreenTarget(sceneTarget, sceneWidth, sceneHeight, true)) {
+            destroyOffscreenTarget(sceneTarget);
+            scale = 1.0f;
+            sceneWidth = outputWidth;
+            sceneHeight = outputHeight;
+        }
+    }
+    if (layerCaching) {
+        destroyLayerCaches();
+        initLayerCaches(rectShader, SCENE_LAYER_COUNT, sceneWidth, sceneHeight);
+    }
+    // Some of what was just deleted may still be shadowed as bound
+    resetGLState();
+    renderScale = scale;
+}
+
+// The window, or the offscreen target when there is none
+void bindOutput(const OffscreenTarget* offscreen, int width, int height) {
+    if (offscreen) {
+        bindOffscreenTarget(*offscreen);
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+}
+
+// Covers the bound output with the scene target, filtered
+void drawUpscaledScene(const ShaderProgram& rectShader) {
+    useProgram(rectShader);
+    glUniform2f(rectShader.uniforms[UNIFORM_TRANSLATION], 0.0f, 0.0f);
+    glUniform2f(rectShader.uniforms[UNIFORM_SCALE], 1.0f, 1.0f);
+    glUniform1f(rectShader.uniforms[UNIFORM_DEPTH], 0.0f);
+    bindTexture2D(0, sceneTarget.colorTexture);
+    bindVertexArray(upscaleVAO);
+    setBlendMode(BLEND_OFF);
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    setBlendMode(BLEND_ALPHA);
 }
 
-void iceCreamLever(int type, float leverPosition, unsigned int rectShader, unsigned int VAO_leverVertical,
-    unsigned int VAO_leverHorizontal) {
+// Knob levels, best first. The render scale starts from whatever the user asked for.
+void initQualityKnobs(QualityGovernor& governor, double targetFps, float startScale) {
+    initQualityGovernor(governor, 1.0 / targetFps);
+    setQualityKnob(governor, KNOB_BITE_MARKS, "bite marks",
+        { (float)BITE_MARKS_FULL, (float)BITE_MARKS_SIMPLE, (float)BITE_MARKS_RECENT });
+    float capacity = (float)simulation.sprinkles.store.capacity();
+    setQualityKnob(governor, KNOB_SPRINKLE_CAP, "sprinkle cap",
+        { capacity, capacity * 2.0f / 3.0f, capacity * 0.4f, capacity * 0.2f });
+    setQualityKnob(governor, KNOB_SPAWN_INTERVAL, "spawn interval",
+        { SPRINKLE_SPAWN_INTERVAL, SPRINKLE_SPAWN_INTERVAL * 1.5f, SPRINKLE_SPAWN_INTERVAL * 2.0f, SPRINKLE_SPAWN_INTERVAL * 3.0f });
+    std::vector<float> scales = { startScale };
+    for (float factor : { 0.85f, 0.7f, 0.5f }) {
+        float scale = std::max(MIN_RENDER_SCALE, startScale * factor);
+        if (scale < scales.back()) scales.push_back(scale);
+    }
+    setQualityKnob(governor, KNOB_RENDER_SCALE, "render scale", scales);
+}
 
-    float verticalScaleY = 1.0f - leverPosition * 0.7f;
-    float verticalPosY = (1.0f - verticalScaleY) * 0.4f;
-    float horizontalPosY = leverPosition * -0.2f;
-    float positionX = 0.0f;
-    switch (type) {
-    case 1: positionX = 0.0f; break;
-    case 2: positionX = 0.16f; break;
-    case 3: positionX = 0.31f; break;
+// Puts the governor's current levels into effect; the render scale goes out with the next frame
+void applyQualityKnobs(const QualityGovernor& governor) {
+    biteMarkDetail = (BiteMarkDetail)(int)qualityKnobValue(governor, KNOB_BITE_MARKS);
+    simulation.sprinkles.liveLimit = (size_t)qualityKnobValue(governor, KNOB_SPRINKLE_CAP);
+    simulation.sprinkles.spawnInterval = qualityKnobValue(governor, KNOB_SPAWN_INTERVAL);
+    renderScaleRequest = qualityKnobValue(governor, KNOB_RENDER_SCALE);
+}
+
+// Draws one frame's list to the output, through the scene target when the scale is below 1
+void renderFrame(const DrawList& list, float scale, const OffscreenTarget* output, int outputWidth, int outputHeight,
+    const ShaderProgram& rectShader, const ShaderProgram& particleShader, unsigned int particleVAO) {
+    if (scale != appliedRenderScale) {
+        appliedRenderScale = scale;
+        applyRenderScale(scale, outputWidth, outputHeight, rectShader);
+    }
+    if (layerCaching) updateLayerCaches(list);
+    size_t overlayStart = firstOverlayCommand(list);
+    if (renderScale < 1.0f) {
+        bindOffscreenTarget(sceneTarget);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawFrame(list, 0, overlayStart, rectShader, particleShader, particleVAO);
+        bindOutput(output, outputWidth, outputHeight);
+        drawUpscaledScene(rectShader);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        drawFrame(list, overlayStart, list.commands.size(), rectShader, particleShader, particleVAO);
+    }
+    else {
+        bindOutput(output, outputWidth, outputHeight);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawFrame(list, 0, list.commands.size(), rectShader, particleShader, particleVAO);
     }
+}
 
-    drawRect(rectShader, VAO_leverVertical, leverVerticalTexture, positionX, verticalPosY, 1.0f, verticalScaleY);
-    drawRect(rectShader, VAO_leverHorizontal, leverHorizontalTexture, positionX, horizontalPosY, 1.0f, 1.0f);
+// Hands the render thread a snapshot it has not seen yet
+void wakeRenderThread() {
+    // Taking the mutex once orders this after the thread's last look at the buffer, so it can't miss the wake
+    { std::lock_guard<std::mutex> lock(renderWakeMutex); }
+    renderWake.notify_one();
 }
 
-void drawIceCreamDrops(unsigned int rectShader, unsigned int VAO) {
-    for (const auto& drop : iceCreamDrops) {
-        if (drop.active && drop.posY > CUP_TOP_POS_Y) {
-            unsigned textureID = 0;
-            switch (drop.flavorType) {
-            case 1: textureID = vanillaPourTexture; break;
-            case 2: textureID = chocolatePourTexture; break;
-            case 3: textureID = mixedPourTexture; break;
-            }
-            drawRect(rectShader, VAO, textureID,
-                0.0f, drop.posY, DROP_WIDTH, drop.height);
+// Takes over the window's context and draws every snapshot it gets to, until told to stop
+void runRenderThread(GLFWwindow* window, int outputWidth, int outputHeight,
+    const ShaderProgram& rectShader, const ShaderProgram& particleShader, unsigned int particleVAO) {
+    glfwMakeContextCurrent(window);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(renderWakeMutex);
+            renderWake.wait(lock, [] { return renderThreadStop.load() || hasFreshSnapshot(frameSnapshots); });
         }
+        if (renderThreadStop.load()) break;
+        takeSnapshot(frameSnapshots);
+        const FrameSnapshot& snapshot = readableSnapshot(frameSnapshots);
+        double startTime = timingNow();
+        bakeToppingInstances(snapshot.resetCount, snapshot.settled);
+        renderFrame(snapshot.drawList, snapshot.renderScale, nullptr, outputWidth, outputHeight,
+            rectShader, particleShader, particleVAO);
+        glfwSwapBuffers(window);
+        lastRenderWork.store(timingNow() - startTime);
+        framesPresented++;
+    }
+    glfwMakeContextCurrent(NULL);
+}
+
+// Mean and peak fragments per pixel of a heat map frame (RGB rows); red counts one per fragment
+void measureOverdraw(const std::vector<unsigned char>& pixels, double& mean, int& peak) {
+    unsigned long long total = 0;
+    peak = 0;
+    for (size_t i = 0; i < pixels.size(); i += 3) {
+        total += pixels[i];
+        if (pixels[i] > peak) peak = pixels[i];
     }
+    mean = pixels.empty() ? 0.0 : (double)total / (pixels.size() / 3);
 }
 void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
+    noteActivity(idleTracker); // The spoon follows the cursor
     int width, height;
     glfwGetWindowSize(window, &width, &height);
 
@@ -174,202 +447,247 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
 }
 
 
+// The window's contents were lost (uncovered, resized) and have to be drawn again
+void window_refresh_callback(GLFWwindow* window) {
+    noteActivity(idleTracker);
+}
+
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+    noteActivity(idleTracker);
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
         mousePressed = (action == GLFW_PRESS);
 
         if (mousePressed) {
-            const float TEXTURE_SCALE = 0.35f; // Adjust this!
-            float scaledFillVanilla = CUP_BOTTOM_POS_Y +
-                (vanillaFill.fillLevel - CUP_BOTTOM_POS_Y) * TEXTURE_SCALE;
-            float scaledFillChocolate = CUP_BOTTOM_POS_Y +
-                (chocolateFill.fillLevel - CUP_BOTTOM_POS_Y) * TEXTURE_SCALE;
-            float scaledFillMixed = CUP_BOTTOM_POS_Y +
-                (mixedFill.fillLevel - CUP_BOTTOM_POS_Y) * TEXTURE_SCALE;
-
-            bool isOnVanilla = vanillaFill.isFilled &&
-                spoonY < scaledFillVanilla &&
-                spoonY > CUP_BOTTOM_POS_Y &&
-                spoonX > 0.1f && spoonX < 0.5f;
-
-            bool isOnChocolate = chocolateFill.isFilled &&
-                spoonY < scaledFillChocolate &&
-                spoonY > CUP_BOTTOM_POS_Y &&
-                spoonX > 0.1f && spoonX < 0.5f;
-
-            bool isOnMixed = mixedFill.isFilled &&
-                spoonY < scaledFillMixed &&
-                spoonY > CUP_BOTTOM_POS_Y &&
-                spoonX > 0.1f && spoonX < 0.5f;
-
-            // Only add bite if clicking on actual ice cream
-            if (isOnVanilla || isOnChocolate || isOnMixed) {
-                // 1. Add bite mark
-                BiteMark bite;
-                bite.x = spoonX;
-                bite.y = spoonY;
-                bite.size = 0.05f;
-                biteMarks.push_back(bite);
-
-                const float REDUCTION = 0.15f;
-
-                if (isOnVanilla && vanillaFill.isFilled) {
-                    vanillaFill.fillLevel -= REDUCTION;
-                    if (vanillaFill.fillLevel <= CUP_BOTTOM_POS_Y) {
-                        vanillaFill.fillLevel = CUP_BOTTOM_POS_Y;
-                        vanillaFill.isFilled = false;
-                    }
-                }
-
-                if (isOnChocolate && chocolateFill.isFilled) {
-                    chocolateFill.fillLevel -= REDUCTION;
-                    if (chocolateFill.fillLevel <= CUP_BOTTOM_POS_Y) {
-                        chocolateFill.fillLevel = CUP_BOTTOM_POS_Y;
-                        chocolateFill.isFilled = false;
-                    }
-                }
-
-                if (isOnMixed && mixedFill.isFilled) {
-                    mixedFill.fillLevel -= REDUCTION;
-                    if (mixedFill.fillLevel <= CUP_BOTTOM_POS_Y) {
-                        mixedFill.fillLevel = CUP_BOTTOM_POS_Y;
-                        mixedFill.isFilled = false;
-                    }
-                }
-                bool cupIsEmpty = !vanillaFill.isFilled &&
-                    !chocolateFill.isFilled &&
-                    !mixedFill.isFilled;
-
-                if (cupIsEmpty) {
-                    // Reset everything
-                    resetCup();
-                    resetSprinkles();
-                    biteMarks.clear();
-                }
-            }
+            biteAt(simulation, spoonX, spoonY);
         }
     }
 }
-void limitFPS() {
-    while (glfwGetTime() < lastTimeForRefresh + 1.0 / FPS) {
-        // Busy wait - CPU spins but gives precise timing
-    }
-    lastTimeForRefresh += 1.0 / FPS;
-}
-void drawBiteMarks(unsigned int rectShader, unsigned int VAO, unsigned int circleTexture) {
-    glUseProgram(rectShader);
-
-    for (const auto& bite : biteMarks) {
-        drawRect(rectShader, VAO, circleTexture, bite.x, bite.y, bite.size, bite.size);
-    }
-}
-
-// Add this function to reduce ice cream when bitten
-void reduceIceCreamFromBites() {
-    if (biteMarks.empty()) return;
-
-    // Base reduction + extra per bite
-    float baseReduction = 0.001f;
-    float extraPerBite = 0.0005f;
-    float totalReduction = baseReduction + (extraPerBite * biteMarks.size());
-
-    // Cap maximum reduction
-    if (totalReduction > 0.01f) totalReduction = 0.01f;
-
-    if (vanillaFill.isFilled) {
-        vanillaFill.fillLevel -= totalReduction;
-        if (vanillaFill.fillLevel < CUP_BOTTOM_POS_Y) {
-            vanillaFill.fillLevel = CUP_BOTTOM_POS_Y;
+int main(int argc, char** argv) {
+    startupTime = startupStageStart = timingNow();
+    // --sprinkle-bench N: renders N resting sprinkles unthrottled and prints the average frame time
+    // --seed N: fixed seed for every sprinkle random stream, so a run can be replayed
+    // --sim-hz N: simulation steps per second, independent of the frame rate
+    // --fps N: frame rate to pace to instead of the monitor's refresh rate
+    // --vsync: let buffer swaps wait for the display instead of the frame pacer
+    // --busy-wait: pace by spinning the whole frame (the old behaviour, for comparison)
+    // --pacing-report: print frame rate, pacing error, jitter and CPU use every few seconds
+    // --headless: no window; render offscreen through a surfaceless EGL (or OSMesa) context
+    // --size WxH: headless frame size (default 1920x1080)
+    // --frames N: headless frames to render before exiting (default 300)
+    // --dump DIR: write every headless frame to DIR/frame_NNNNN.ppm
+    // --pour vanilla|chocolate|mixed, --sprinkles: start with that lever pulled
+    // --no-shader-cache: compile every shader from source, for timing a cold start
+    // --no-layer-cache: draw the static layers sprite by sprite every frame
+    // --no-idle: keep drawing every frame even when nothing on screen moves
+    // --no-hulls: blend every sprite over its whole quad, in order, without the opaque depth pass
+    // --overdraw: show how many fragments each pixel gets instead of the picture (headless runs print the average)
+    // --render-scale S|auto: draw the scene at S (0.25 to 1) times the output resolution and scale it up;
+    //     auto picks the scale that keeps it near 1080p
+    // --no-governor: keep every quality setting fixed instead of lowering it when frames run over budget
+    // --single-thread: simulate, draw and swap on the main thread, one after the other
+    size_t benchSprinkles = 0;
+    double targetFps = 0.0;
+    FramePacingMode pacingMode = PACING_HYBRID;
+    bool pacingReport = false;
+    bool idleWaiting = true;
+    double simulationHz = DEFAULT_SIMULATION_HZ;
+    bool seeded = false;
+    uint64_t seed = 0;
+    bool headless = false;
+    int headlessWidth = 1920, headlessHeight = 1080;
+    int headlessFrames = 300;
+    std::string dumpDirectory;
+    bool startPours[4] = { false, false, false, false };
+    bool startSprinkles = false;
+    float requestedRenderScale = 1.0f;
+    bool autoRenderScale = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--sprinkle-bench" && i + 1 < argc) {
+            benchSprinkles = std::stoul(argv[++i]);
         }
-    }
-
-    if (chocolateFill.isFilled) {
-        chocolateFill.fillLevel -= totalReduction;
-        if (chocolateFill.fillLevel < CUP_BOTTOM_POS_Y) {
-            chocolateFill.fillLevel = CUP_BOTTOM_POS_Y;
+        else if (std::string(argv[i]) == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+            seeded = true;
         }
-    }
-
-    if (mixedFill.isFilled) {
-        mixedFill.fillLevel -= totalReduction;
-        if (mixedFill.fillLevel < CUP_BOTTOM_POS_Y) {
-            mixedFill.fillLevel = CUP_BOTTOM_POS_Y;
+        else if (std::string(argv[i]) == "--sim-hz" && i + 1 < argc) {
+            simulationHz = std::stod(argv[++i]);
+            if (simulationHz <= 0.0) simulationHz = DEFAULT_SIMULATION_HZ;
+        }
+        else if (std::string(argv[i]) == "--fps" && i + 1 < argc) {
+            targetFps = std::stod(argv[++i]);
+        }
+        else if (std::string(argv[i]) == "--vsync") {
+            pacingMode = PACING_VSYNC;
+        }
+        else if (std::string(argv[i]) == "--busy-wait") {
+            pacingMode = PACING_SPIN;
+        }
+        else if (std::string(argv[i]) == "--pacing-report") {
+            pacingReport = true;
+        }
+        else if (std::string(argv[i]) == "--no-shader-cache") {
+            setShaderCacheDirectory("");
+        }
+        else if (std::string(argv[i]) == "--no-idle") {
+            idleWaiting = false;
+        }
+        else if (std::string(argv[i]) == "--no-layer-cache") {
+            layerCaching = false;
+        }
+        else if (std::string(argv[i]) == "--no-hulls") {
+            hullSplit = false;
+        }
+        else if (std::string(argv[i]) == "--overdraw") {
+            overdrawView = true;
+        }
+        else if (std::string(argv[i]) == "--render-scale" && i + 1 < argc) {
+            std::string scale = argv[++i];
+            if (scale == "auto") autoRenderScale = true;
+            else requestedRenderScale = std::stof(scale);
+        }
+        else if (std::string(argv[i]) == "--no-governor") {
+            qualityGoverning = false;
+        }
+        else if (std::string(argv[i]) == "--single-thread") {
+            renderThreading = false;
+        }
+        else if (std::string(argv[i]) == "--headless") {
+            headless = true;
+        }
+        else if (std::string(argv[i]) == "--size" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &headlessWidth, &headlessHeight) != 2 ||
+                headlessWidth <= 0 || headlessHeight <= 0) {
+                std::cout << "--size expects WxH, e.g. 1280x720" << std::endl;
+                return -1;
+            }
+        }
+        else if (std::string(argv[i]) == "--frames" && i + 1 < argc) {
+            headlessFrames = std::stoi(argv[++i]);
+        }
+        else if (std::string(argv[i]) == "--dump" && i + 1 < argc) {
+            dumpDirectory = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--pour" && i + 1 < argc) {
+            std::string flavor = argv[++i];
+            if (flavor == "vanilla") startPours[1] = true;
+            else if (flavor == "chocolate") startPours[2] = true;
+            else if (flavor == "mixed") startPours[3] = true;
+        }
+        else if (std::string(argv[i]) == "--sprinkles") {
+            startSprinkles = true;
         }
     }
-}
-int main() {
-    glfwInit();
+
+    // Every loader looks in the pack first and reads loose files for anything it lacks
+    openAssetPack(ASSET_PACK_PATH);
+    endStartupStage("asset pack");
+
+    // The atlas (cooked file or decoded images) is read on another thread while the window and
+    // context come up; it needs no GL until the upload. Declared before the future, whose
+    // destructor waits, so an early return never leaves the thread writing into freed memory.
+    addSceneImages(sceneSprites);
+    TextureFile atlasFile;
+    double atlasPrepareSeconds = 0.0;
+    std::future<bool> atlasPrepared = std::async(std::launch::async, [&atlasFile, &atlasPrepareSeconds]() {
+        double start = timingNow();
+        bool prepared = prepareAtlas(atlasFile);
+        atlasPrepareSeconds = timingNow() - start;
+        return prepared;
+    });
+
+    // The null platform needs no display server; its window only carries the GL context
+    if (headless && glfwPlatformSupported(GLFW_PLATFORM_NULL)) glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    if (!glfwInit()) return endProgram("GLFW failed to initialize");
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    GLFWmonitor* monitor = glfwGetPrimaryMonitor();
-    const GLFWvidmode* mode = glfwGetVideoMode(monitor);
-    GLFWwindow* window = glfwCreateWindow(mode->width, mode->height, "Ice Cream Machine", monitor, NULL);
-    //GLFWwindow* window = glfwCreateWindow(800, 800, "Vezba 2", NULL, NULL);
+    glfwWindowHint(GLFW_DEPTH_BITS, 24);
+
+    GLFWwindow* window = NULL;
+    const GLFWvidmode* mode = NULL;
+    if (headless) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        // Mesa's surfaceless EGL first, OSMesa (llvmpipe) when EGL isn't there
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+        window = glfwCreateWindow(headlessWidth, headlessHeight, "Ice Cream Machine", NULL, NULL);
+        if (!window) {
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+            window = glfwCreateWindow(headlessWidth, headlessHeight, "Ice Cream Machine", NULL, NULL);
+        }
+    }
+    else {
+        GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+        mode = glfwGetVideoMode(monitor);
+        window = glfwCreateWindow(mode->width, mode->height, "Ice Cream Machine", monitor, NULL);
+        //GLFWwindow* window = glfwCreateWindow(800, 800, "Vezba 2", NULL, NULL);
+    }
 
     if (!window) return endProgram("Failed to create window");
 
     glfwMakeContextCurrent(window);
     glfwSetKeyCallback(window, key_callback);
 
-    if (glewInit() != GLEW_OK) return endProgram("GLEW failed to initialize");
+    GLenum glewStatus = glewInit();
+    // A GLX build of GLEW reports the missing X display, but the core entry points still load
+    if (glewStatus != GLEW_OK && !(headless && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY)) {
+        return endProgram("GLEW failed to initialize");
+    }
+    endStartupStage("window and context");
+
+    // The driver compiles these while the atlas finishes and uploads; nothing waits on them until
+    // finishShader()
+    PendingShader pendingRectShader = beginShader("rect.vert", "rect.frag");
+    PendingShader pendingParticleShader = beginShader("particle.vert", "particle.frag");
+    endStartupStage("shader submit");
+
+    // Without a window every frame goes into this framebuffer instead
+    OffscreenTarget offscreen;
+    if (headless && !initOffscreenTarget(offscreen, headlessWidth, headlessHeight)) {
+        return endProgram("Failed to create offscreen framebuffer");
+    }
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    setBlendMode(BLEND_ALPHA);
  
     // Initialize systems
-    initSprinkles();
-    initIceCream();
+    initSimulation(simulation);
+    if (seeded) seedSprinkles(simulation.sprinkles, seed);
+    for (int flavorType = 1; flavorType <= 3; flavorType++) {
+        if (startPours[flavorType]) toggleFlavor(simulation, flavorType);
+    }
+    if (startSprinkles) toggleSprinkles(simulation);
     // Load textures
-    preprocessTexture(machineTexture, "res/machine.png");
-    preprocessTexture(leverVerticalTexture, "res/lever.png");
-    preprocessTexture(leverHorizontalTexture, "res/handle.png");
-    preprocessTexture(sprinklesCloseTexture, "res/sprinklesClose.png");
-    preprocessTexture(sprinklesOpenTexture, "res/sprinklesOpen.png");
-    preprocessTexture(vanillaPourTexture, "res/vanillaPour.png");
-    preprocessTexture(chocolatePourTexture, "res/chocolatePour.png");
-    preprocessTexture(mixedPourTexture, "res/mixedPour.png");
-    preprocessTexture(iceCreamVanillaTexture, "res/iceCreamVanilla.png");
-    preprocessTexture(iceCreamChocolateTexture, "res/iceCreamChocolate.png");
-    preprocessTexture(iceCreamMixedTexture, "res/iceCreamMixed.png");
-    preprocessTexture(cupFrontTexture, "res/cupFront.png");
-    preprocessTexture(cupBackTexture, "res/cupBack.png");
-    preprocessTexture(spoonTexture, "res/spoon.png");
-    preprocessTexture(circularTexture, "res/circle.png");
-    preprocessTexture(nameTexture, "res/nameTag.png");
-    preprocessTexture(glassTexture, "res/glass.png");
+    bool atlasReady = atlasPrepared.get();
+    endStartupStage("atlas wait");
+    if (!atlasReady || !uploadAtlas(atlasFile)) return endProgram("Failed to build texture atlas");
+    atlasFile = TextureFile();
+    endStartupStage("atlas upload");
 
     // Create shaders
-    unsigned int rectShader = createShader("rect.vert", "rect.frag");
-    if (rectShader == 0) return endProgram("Failed to create rectangle shader");
-
-    unsigned int particleShader = createShader("particle.vert", "particle.frag");
-    if (particleShader == 0) return endProgram("Failed to create particle shader");
-
-    unsigned int VAO_machine, VAO_leverVertical, VAO_leverHorizontal, VAO_sprinklesLever, VAO_iceCreamVanilla, VAO_cup, VAO_name, VAO_glass;
-
-    float rectVertices[] = {
-        -1.0f,  1.0f,   0.0f, 1.0f,
-        -1.0f, -1.0f,   0.0f, 0.0f,
-         1.0f, -1.0f,   1.0f, 0.0f,
-         1.0f,  1.0f,   1.0f, 1.0f
-    };
-
+    // Uniform locations are looked up here once, not per draw
+    ShaderProgram rectShader;
+    initShaderProgram(rectShader, finishShader(pendingRectShader));
+    if (rectShader.id == 0) return endProgram("Failed to create rectangle shader");
+
+    ShaderProgram particleShader;
+    initShaderProgram(particleShader, finishShader(pendingParticleShader));
+    if (particleShader.id == 0) return endProgram("Failed to create particle shader");
+    endStartupStage("shader link");
+    int shaderCacheHits, shaderCacheMisses;
+    getShaderCacheStats(shaderCacheHits, shaderCacheMisses);
+    if (shaderCacheHits + shaderCacheMisses > 0) {
+        std::cout << "Shader cache: " << shaderCacheHits << " loaded, " << shaderCacheMisses << " compiled" << std::endl;
+    }
 
-    formVAOs(rectVertices, sizeof(rectVertices), VAO_machine);
-    formVAOs(rectVertices, sizeof(rectVertices), VAO_leverVertical);
-    formVAOs(rectVertices, sizeof(rectVertices), VAO_leverHorizontal);
-    formVAOs(rectVertices, sizeof(rectVertices), VAO_sprinklesLever);
-    formVAOs(rectVertices, sizeof(rectVertices), VAO_iceCreamVanilla);
-    formVAOs(rectVertices, sizeof(rectVertices), VAO_cup);
-    formVAOs(rectVertices, sizeof(rectVertices), VAO_spoon);
-    formVAOs(rectVertices, sizeof(rectVertices), VAO_name);
-    formVAOs(rectVertices, sizeof(rectVertices), VAO_glass);
+    // Every textured layer goes through one streaming batch on top of the atlas
+    initSpriteBatch(rectShader);
 
-    unsigned int particleVAO, particleVBO;
+    unsigned int particleVAO;
     int width, height;
     glfwGetWindowSize(window, &width, &height);
+    if (headless) {
+        width = headlessWidth;
+        height = headlessHeight;
+    }
     float aspect = (float)width / height;
 
     float particleVertices[] = {
@@ -380,108 +698,241 @@ int main() {
     };
 
     formVAOs(particleVertices, sizeof(particleVertices), particleVAO);
+    initSprinklesRendering(particleShader, particleVAO, aspect);
+
+    // Sprinkles that came to rest in the cup are drawn into this layer once instead of every frame
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    if (headless) {
+        framebufferWidth = headlessWidth;
+        framebufferHeight = headlessHeight;
+    }
+    initToppings(rectShader, particleShader, particleVAO, framebufferWidth, framebufferHeight, simulation.sprinkles);
+    // The machine's static layers, composited offscreen and redrawn only when they change, and the
+    // target the scene is drawn into below full resolution; applyRenderScale() sizes both
+    float upscaleVertices[] = {
+        -1.0f,  1.0f,   0.0f, 1.0f,
+        -1.0f, -1.0f,   0.0f, 0.0f,
+         1.0f, -1.0f,   1.0f, 0.0f,
+         1.0f,  1.0f,   1.0f, 1.0f
+    };
+    formVAOs(upscaleVertices, sizeof(upscaleVertices), upscaleVAO);
+    if (autoRenderScale) {
+        requestedRenderScale = (float)std::min(1.0, std::sqrt(AUTO_RENDER_PIXELS / ((double)framebufferWidth * framebufferHeight)));
+    }
+    applyRenderScale(requestedRenderScale, framebufferWidth, framebufferHeight, rectShader);
+    renderScaleRequest = appliedRenderScale = renderScale;
+    if (renderScale < 1.0f) {
+        std::cout << "Render scale: " << renderScale << ", scene drawn at " << sceneTarget.width << "x" << sceneTarget.height
+            << " and scaled up to " << framebufferWidth << "x" << framebufferHeight << std::endl;
+    }
 
-    glClearColor(0.392156862745098f, 0.4470588235294118f, 0.4901960784313725f, 1.0f);
-    lastUpdateTime = glfwGetTime();
+    const int BENCH_WARMUP_FRAMES = 60;
+    const int BENCH_FRAMES = 600;
+    int benchFrame = 0;
+    double benchStartTime = 0.0;
+    if (benchSprinkles > 0) {
+        // Keep the resting bench sprinkles live so the instanced path is what gets measured
+        simulation.sprinkles.bakingEnabled = false;
+        spawnBenchmarkSprinkles(simulation.sprinkles, benchSprinkles);
+    }
 
-    lastTimeForRefresh = glfwGetTime();
+    // Pace to the display unless told otherwise; some drivers report 0 Hz
+    if (targetFps <= 0.0 && headless) targetFps = HEADLESS_FPS;
+    if (targetFps <= 0.0) targetFps = mode->refreshRate > 0 ? mode->refreshRate : FALLBACK_REFRESH_RATE;
+    if (!headless) glfwSwapInterval(pacingMode == PACING_VSYNC && benchSprinkles == 0 ? 1 : 0);
+    // Headless and benchmark frames are timed, and must each be drawn, one after the other
+    if (headless || benchSprinkles > 0) renderThreading = false;
+    // With vsync the render thread's swap waits for the display, so the simulation paces itself
+    initFramePacer(framePacer, renderThreading && pacingMode == PACING_VSYNC ? PACING_HYBRID : pacingMode, targetFps);
+    // Headless and benchmark runs must do the same work every time, and a swap that waits for the
+    // display makes every frame look exactly on budget
+    if (headless || benchSprinkles > 0 || pacingMode == PACING_VSYNC) qualityGoverning = false;
+    if (qualityGoverning) initQualityKnobs(qualityGovernor, targetFps, renderScale);
+
+    glClearColor(BACKGROUND_COLOR[0], BACKGROUND_COLOR[1], BACKGROUND_COLOR[2], BACKGROUND_COLOR[3]);
+    if (overdrawView) glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    lastUpdateTime = glfwGetTime();
+    initFixedStepClock(simulationClock, simulationHz, MAX_SIMULATION_STEPS_PER_FRAME);
 
     glfwSetCursorPosCallback(window, cursor_position_callback);
+    // The compositor lost the window contents (uncovered, resized): draw them again
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     // Hide default cursor
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+    endStartupStage("renderer setup");
+    bool startupReported = false;
+    int headlessFrame = 0;
+    double headlessRenderTime = 0.0;
+    std::vector<unsigned char> framePixels;
+    double overdrawTotal = 0.0;
+    int overdrawPeak = 0;
+    initIdleTracker(idleTracker, IDLE_DELAY);
+    if (renderThreading) {
+        initSnapshotBuffer(frameSnapshots);
+        glfwMakeContextCurrent(NULL);
+        renderThread = std::thread([&]() {
+            runRenderThread(window, framebufferWidth, framebufferHeight, rectShader, particleShader, particleVAO);
+        });
+    }
     while (!glfwWindowShouldClose(window)) {
+        // Nothing on screen would change: wait for input instead of drawing the same frame again
+        if (idleWaiting && !headless && benchSprinkles == 0 && isIdle(idleTracker)) {
+            double idleStart = timingNow();
+            glfwWaitEventsTimeout(IDLE_WAIT_TIMEOUT);
+            resumeFramePacer(framePacer, timingNow() - idleStart);
+            // Everything was at rest, so the wait is skipped instead of simulated
+            lastUpdateTime = glfwGetTime();
+            if (pacingReport) printPacingReport(targetFps);
+            continue;
+        }
+
         double currentTime = glfwGetTime();
         double deltaTime = currentTime - lastUpdateTime;
         lastUpdateTime = currentTime;
-        vanillaFilled = vanillaFill.isFilled;
-        vanillaLevel = vanillaFill.fillLevel;
-        chocolateFilled = chocolateFill.isFilled;
-        chocolateLevel = chocolateFill.fillLevel;
-        mixedFilled = mixedFill.isFilled;
-        mixedLevel = mixedFill.fillLevel;
-        cupBottomY = CUP_BOTTOM_POS_Y;
-
-        updateLevers(deltaTime);
-        updateIceCreamDrops(deltaTime);
-        updateSprinklesPhysics(deltaTime);
-
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // Draw background elements first
-        drawRect(rectShader, VAO_cup, cupBackTexture, 0.0f, 0.0f, 1.0f, 1.0f);
-
-        // Draw the piled ice cream drops (inside the cup)
-        drawIceCreamDrops(rectShader, VAO_iceCreamVanilla);
-
-        // Draw the vanilla fill layer (optional - can remove if using only piled drops)
-        if (vanillaFill.isFilled && vanillaFill.fillLevel > CUP_BOTTOM_POS_Y) {
-            float fillHeight = vanillaFill.fillLevel - CUP_BOTTOM_POS_Y;
-            float fillPosY = CUP_BOTTOM_POS_Y + (fillHeight / 2.0f);
-            drawRect(rectShader, VAO_iceCreamVanilla, iceCreamVanillaTexture,
-                0.0f, fillPosY, CUP_FILL_WIDTH, fillHeight);
+        // Headless frames are evenly spaced in simulation time, so a seeded run renders the same images
+        if (headless) deltaTime = 1.0 / targetFps;
+
+        // The simulation runs in fixed steps; drawing blends between the last two
+        int steps = advanceFixedStepClock(simulationClock, deltaTime);
+        // The benchmark wants the same work in every frame, whatever the frame time
+        if (benchSprinkles > 0) steps = 1;
+        bool moving = false;
+        for (int step = 0; step < steps; step++) {
+            if (updateSimulation(simulation, simulationClock.stepSize)) moving = true;
         }
-
-        // Draw chocolate fill layer
-        if (chocolateFill.isFilled && chocolateFill.fillLevel > CUP_BOTTOM_POS_Y) {
-            float fillHeight = chocolateFill.fillLevel - CUP_BOTTOM_POS_Y;
-            float fillPosY = CUP_BOTTOM_POS_Y + (fillHeight / 2.0f);
-            drawRect(rectShader, VAO_iceCreamVanilla, iceCreamChocolateTexture,
-                0.0f, fillPosY, CUP_FILL_WIDTH, fillHeight);
+        if (moving) noteActivity(idleTracker);
+        float alpha = fixedStepAlpha(simulationClock);
+
+        if (renderThreading) {
+            FrameSnapshot& snapshot = writableSnapshot(frameSnapshots);
+            buildScene(snapshot.drawList, simulation, sceneSprites, alpha, spoonX, spoonY, spoonSize, biteMarkDetail);
+            takeSettledSprinkles(snapshot, simulation.sprinkles);
+            snapshot.renderScale = renderScaleRequest;
+            publishSnapshot(frameSnapshots);
+            wakeRenderThread();
         }
-
-        // Draw mixed fill layer
-        if (mixedFill.isFilled && mixedFill.fillLevel > CUP_BOTTOM_POS_Y) {
-            float fillHeight = mixedFill.fillLevel - CUP_BOTTOM_POS_Y;
-            float fillPosY = CUP_BOTTOM_POS_Y + (fillHeight / 2.0f);
-            drawRect(rectShader, VAO_iceCreamVanilla, iceCreamMixedTexture,
-                0.0f, fillPosY, CUP_FILL_WIDTH, fillHeight);
-        }        
-
-        // Draw the machine and levers (on top of cup)
-        drawRect(rectShader, VAO_machine, machineTexture, 0.0f, 0.0f, 1.0f, 1.0f);
-        drawRect(rectShader, VAO_name, nameTexture, 0.0f, 0.0f, 1.0f, 1.0f);
-        drawRect(rectShader, VAO_cup, cupFrontTexture, 0.0f, 0.0f, 1.0f, 1.0f);
-        static double lastSprinkleSpawnTime = 0.0;
-        if (sprinklesOpen && currentTime - lastSprinkleSpawnTime > 0.08f) {
-            spawnSprinkles();
-            lastSprinkleSpawnTime = currentTime;
+        else {
+            // The list is built first so layers that changed are redrawn before the frame starts, like the toppings
+            buildScene(frameDrawList, simulation, sceneSprites, alpha, spoonX, spoonY, spoonSize, biteMarkDetail);
+            bakeToppings(simulation.sprinkles);
+            renderFrame(frameDrawList, renderScaleRequest, headless ? &offscreen : nullptr, framebufferWidth, framebufferHeight,
+                rectShader, particleShader, particleVAO);
         }
 
-        for (const auto& drop : sprinkles) {
-            drawSprinkles(drop, particleShader, particleVAO);
+        if (headless) {
+            glFinish();
+            headlessRenderTime += glfwGetTime() - currentTime;
+            if (overdrawView) {
+                double mean;
+                int peak;
+                readOffscreenPixels(offscreen, framePixels);
+                measureOverdraw(framePixels, mean, peak);
+                overdrawTotal += mean;
+                overdrawPeak = std::max(overdrawPeak, peak);
+            }
+            if (!dumpDirectory.empty()) {
+                char path[64];
+                std::snprintf(path, sizeof(path), "/frame_%05d.ppm", headlessFrame);
+                readOffscreenPixels(offscreen, framePixels);
+                writePPM(dumpDirectory + path, offscreen.width, offscreen.height, framePixels);
+            }
+            headlessFrame++;
+            if (headlessFrame >= headlessFrames && benchSprinkles == 0) glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+        else if (!renderThreading) {
+            glfwSwapBuffers(window);
+        }
+        glfwPollEvents();
+        if (!startupReported && (!renderThreading || framesPresented.load() > 0)) {
+            endStartupStage("first frame");
+            printStartupReport(atlasPrepareSeconds);
+            startupReported = true;
         }
-        drawBiteMarks(rectShader, VAO_spoon, circularTexture); // or drawBiteMarks() if using immediate mode
-
-        iceCreamLever(1, leverPositionVanilla, rectShader, VAO_leverVertical, VAO_leverHorizontal);
-        iceCreamLever(2, leverPositionMixed, rectShader, VAO_leverVertical, VAO_leverHorizontal);
-        iceCreamLever(3, leverPositionChocolate, rectShader, VAO_leverVertical, VAO_leverHorizontal);
 
-        if (sprinklesOpen) {
-            drawRect(rectShader, VAO_sprinklesLever, sprinklesOpenTexture, 0.0f, 0.0f, 1.0f, 1.0f);
+        if (benchSprinkles > 0) {
+            glFinish();
+            benchFrame++;
+            if (benchFrame == BENCH_WARMUP_FRAMES) {
+                benchStartTime = glfwGetTime();
+            }
+            else if (benchFrame == BENCH_WARMUP_FRAMES + BENCH_FRAMES) {
+                double frameMs = (glfwGetTime() - benchStartTime) * 1000.0 / BENCH_FRAMES;
+                std::cout << "Sprinkle bench: " << simulation.sprinkles.store.count() << " sprinkles, "
+                    << frameMs << " ms/frame" << std::endl;
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+            }
+            continue;
         }
-        else {
-            drawRect(rectShader, VAO_sprinklesLever, sprinklesCloseTexture, 0.0f, 0.0f, 1.0f, 1.0f);
+        if (headless) continue;
+        // The frame's own work, up to the swap; the pacer's wait is not part of it. With the render
+        // thread the slower of the two threads sets the pace.
+        double frameWork = glfwGetTime() - currentTime;
+        if (renderThreading) frameWork = std::max(frameWork, lastRenderWork.load());
+        if (qualityGoverning && updateQualityGovernor(qualityGovernor, frameWork, glfwGetTime())) {
+            applyQualityKnobs(qualityGovernor);
         }
+        waitForNextFrame(framePacer);
+        if (pacingReport) printPacingReport(targetFps);
+    }
+    destroyFramePacer(framePacer);
+    if (renderThreading) {
+        renderThreadStop.store(true);
+        wakeRenderThread();
+        renderThread.join();
+        glfwMakeContextCurrent(window);
+        std::cout << "Render thread: " << framesPresented.load() << " frames presented, " << frameSnapshots.dropped
+            << " of " << frameSnapshots.published << " snapshots replaced before they were drawn" << std::endl;
+    }
 
-        drawRect(rectShader, VAO_glass, glassTexture, 0.0f, 0.0f, 1.0f, 1.0f);
+    if (headless && headlessFrame > 0) {
+        std::cout << "Headless: " << headlessFrame << " frames at " << headlessWidth << "x" << headlessHeight
+            << ", " << headlessRenderTime * 1000.0 / headlessFrame << " ms/frame" << std::endl;
+        if (overdrawView) {
+            std::cout << "Overdraw: " << overdrawTotal / headlessFrame << " fragments per pixel on average, "
+                << overdrawPeak << " at most (" << (hullSplit ? "opaque/translucent split" : "in order") << ")" << std::endl;
+        }
+    }
 
-        
-        drawRect(rectShader, VAO_spoon, spoonTexture, spoonX, spoonY, spoonSize, spoonSize);
+    TunnelStats tunnel = getTunnelStats(simulation.sprinkles);
+    if (tunnel.exits > 0) {
+        std::cout << "Sprinkle tunnel: " << tunnel.exits << " exits, max queue depth "
+            << tunnel.maxQueueDepth << ", average extra wait "
+            << tunnel.totalWaitTime * 1000.0 / tunnel.exits << " ms" << std::endl;
+    }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-        limitFPS();
+    GLStateStats glState = takeGLStateStats();
+    unsigned long long binds = glState.programBinds + glState.textureBinds + glState.vertexArrayBinds;
+    unsigned long long skips = glState.programSkips + glState.textureSkips + glState.vertexArraySkips;
+    if (binds + skips > 0) {
+        std::cout << "GL state: " << skips << " of " << binds + skips << " binds skipped (program "
+            << glState.programSkips << "/" << glState.programBinds + glState.programSkips << ", texture "
+            << glState.textureSkips << "/" << glState.textureBinds + glState.textureSkips << ", vertex array "
+            << glState.vertexArraySkips << "/" << glState.vertexArrayBinds + glState.vertexArraySkips << ")" << std::endl;
+        std::cout << "GL state: " << glState.blendSkips << " of " << glState.blendChanges + glState.blendSkips
+            << " blend mode changes skipped" << std::endl;
+    }
 
+    LayerCacheStats layerStats = takeLayerCacheStats();
+    if (layerStats.draws > 0) {
+        std::cout << "Layer cache: " << layerStats.draws << " layers drawn, " << layerStats.redraws << " redrawn" << std::endl;
     }
 
-    glDeleteProgram(rectShader);
-    glDeleteProgram(particleShader);
-    glDeleteVertexArrays(1, &VAO_machine);
-    glDeleteVertexArrays(1, &VAO_leverVertical);
-    glDeleteVertexArrays(1, &VAO_leverHorizontal);
+    destroyShaderProgram(rectShader);
+    destroyShaderProgram(particleShader);
+    glDeleteVertexArrays(1, &particleVAO);
+    destroySpriteBatch();
+    destroyToppings();
+    if (layerCaching) destroyLayerCaches();
+    if (sceneTarget.framebuffer != 0) destroyOffscreenTarget(sceneTarget);
+    glDeleteVertexArrays(1, &upscaleVAO);
+    destroySprinklesRendering();
+    if (headless) destroyOffscreenTarget(offscreen);
+    glDeleteTextures(1, &atlasTexture);
 
     glfwDestroyWindow(window);
+    closeAssetPack();
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "Offscreen.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <iostream>
+#include "GLState.h"
+
+bool initOffscreenTarget(OffscreenTarget& target, int width, int height, bool sampled) {
+    target.width = width;
+    target.height = height;
+
+    if (sampled) {
+        glGenTextures(1, &target.colorTexture);
+        bindTexture2D(0, target.colorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        bindTexture2D(0, 0);
+    }
+    else {
+        glGenRenderbuffers(1, &target.colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, target.colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    }
+    glGenRenderbuffers(1, &target.depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    if (sampled) glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.colorTexture, 0);
+    else glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.depthBuffer);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        std::cout << "Offscreen framebuffer is incomplete" << std::endl;
+    }
+    return complete;
+}
+
+void bindOffscreenTarget(const OffscreenTarget& target) {
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glViewport(0, 0, target.width, target.height);
+}
+
+void readOffscreenPixels(const OffscreenTarget& target, std::vector<unsigned char>& pixels) {
+    const size_t rowSize = (size_t)target.width * 3;
+    std::vector<unsigned char> rows(rowSize * target.height);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target.framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, target.width, target.height, GL_RGB, GL_UNSIGNED_BYTE, rows.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    // GL hands rows back bottom first
+    pixels.resize(rows.size());
+    for (int y = 0; y < target.height; y++) {
+        std::copy(rows.begin() + (target.height - 1 - y) * rowSize,
+            rows.begin() + (target.height - y) * rowSize, pixels.begin() + y * rowSize);
+    }
+}
+
+void destroyOffscreenTarget(OffscreenTarget& target) {
+    glDeleteFramebuffers(1, &target.framebuffer);
+    glDeleteRenderbuffers(1, &target.colorBuffer);
+    glDeleteTextures(1, &target.colorTexture);
+    glDeleteRenderbuffers(1, &target.depthBuffer);
+    target = OffscreenTarget();
+}
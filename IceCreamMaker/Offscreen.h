@@ -0,0 +1,25 @@
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include <vector>
+
+// Color and depth buffer the frame is drawn into when there is no window to draw to, or the
+// scene is drawn into at a lower resolution before it is scaled up
+struct OffscreenTarget {
+    unsigned int framebuffer = 0;
+    unsigned int colorBuffer = 0;  // Renderbuffer, unless the target is sampled
+    unsigned int colorTexture = 0; // Bilinear texture, when it is
+    unsigned int depthBuffer = 0;
+    int width = 0, height = 0;
+};
+
+// Function declarations
+// sampled: color goes into colorTexture so it can be drawn elsewhere
+bool initOffscreenTarget(OffscreenTarget& target, int width, int height, bool sampled = false);
+// Makes the target the framebuffer that the following draws go to
+void bindOffscreenTarget(const OffscreenTarget& target);
+// Reads the target back as tightly packed RGB rows, top row first, ready for writePPM()
+void readOffscreenPixels(const OffscreenTarget& target, std::vector<unsigned char>& pixels);
+void destroyOffscreenTarget(OffscreenTarget& target);
+
+#endif
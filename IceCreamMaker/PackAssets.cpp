@@ -0,0 +1,29 @@
+// Build-time packer: writes the listed files into one indexed, aligned asset pack that the
+// game memory-maps at startup (see AssetPack.h). Names are stored as given, so run it from
+// this directory with paths like res/machine.png; make pack does that for everything.
+// Built by the Makefile only; the Visual Studio project keeps Main.cpp as its single entry point.
+#include <iostream>
+#include <string>
+#include <vector>
+#include "AssetPack.h"
+
+int main(int argc, char** argv) {
+    // --out PATH: where to write the pack (default assets.pack, where the game looks)
+    // everything else: files to pack
+    std::string outPath = ASSET_PACK_PATH;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+        else {
+            files.push_back(option);
+        }
+    }
+    if (files.empty()) {
+        std::cout << "Usage: packassets [--out PATH] FILE..." << std::endl;
+        return 1;
+    }
+    return writeAssetPack(outPath.c_str(), files) ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#include "QualityGovernor.h"
+#include <algorithm>
+#include <iostream>
+
+// Constants
+// A change is judged on a window measured entirely after it, but no fewer frames than this
+static const size_t MIN_DECISION_FRAMES = 30;
+static const double BASE_UP_HOLD = 2.0;  // Seconds of headroom before a knob goes back up
+static const double MAX_UP_HOLD = 60.0;
+// Stepping a knob down this soon after raising it means the raise was a mistake
+static const double REVERT_WINDOW = 5.0;
+
+void initQualityGovernor(QualityGovernor& governor, double frameBudget, size_t windowFrames) {
+    governor.budget = frameBudget;
+    governor.samples.assign(std::max(windowFrames, MIN_DECISION_FRAMES), 0.0);
+    governor.nextSample = 0;
+    governor.sampleCount = 0;
+    governor.lastChange = 0.0;
+    governor.headroomSince = -1.0;
+    governor.lowered.clear();
+    governor.lastRaise = -1.0e9;
+    governor.lastRaised = -1;
+}
+
+void setQualityKnob(QualityGovernor& governor, QualityKnobId knob, const char* name, const std::vector<float>& levels) {
+    QualityKnob& k = governor.knobs[knob];
+    k.name = name;
+    k.levels = levels;
+    k.level = 0;
+    k.upHold = BASE_UP_HOLD;
+}
+
+float qualityKnobValue(const QualityGovernor& governor, QualityKnobId knob) {
+    const QualityKnob& k = governor.knobs[knob];
+    return k.levels.empty() ? 0.0f : k.levels[k.level];
+}
+
+double qualityPercentile(const QualityGovernor& governor, double p) {
+    if (governor.sampleCount == 0) return 0.0;
+    std::vector<double> sorted(governor.samples.begin(), governor.samples.begin() + governor.sampleCount);
+    size_t rank = std::min(sorted.size() - 1, (size_t)(p * sorted.size()));
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
+
+static void changeKnob(QualityGovernor& governor, int knob, int level, double now, double p50, double p95) {
+    QualityKnob& k = governor.knobs[knob];
+    std::cout << "Quality: " << k.name << " " << k.levels[k.level] << " -> " << k.levels[level]
+        << " (p50 " << p50 * 1000.0 << " ms, p95 " << p95 * 1000.0 << " ms, budget "
+        << governor.budget * 1000.0 << " ms)" << std::endl;
+    k.level = level;
+    // The window so far describes the old setting
+    governor.sampleCount = 0;
+    governor.nextSample = 0;
+    governor.lastChange = now;
+    governor.headroomSince = -1.0;
+}
+
+bool updateQualityGovernor(QualityGovernor& governor, double frameSeconds, double now) {
+    governor.samples[governor.nextSample] = frameSeconds;
+    governor.nextSample = (governor.nextSample + 1) % governor.samples.size();
+    if (governor.sampleCount < governor.samples.size()) governor.sampleCount++;
+    if (governor.sampleCount < MIN_DECISION_FRAMES) return false;
+
+    double p50 = qualityPercentile(governor, 0.5);
+    double p95 = qualityPercentile(governor, 0.95);
+    if (p95 > governor.budget * governor.downThreshold) {
+        governor.headroomSince = -1.0;
+        for (int knob = 0; knob < QUALITY_KNOB_COUNT; knob++) {
+            QualityKnob& k = governor.knobs[knob];
+            if (k.level + 1 >= (int)k.levels.size()) continue;
+            // Undoing a recent raise: wait longer before trying that one again
+            if (knob == governor.lastRaised && now - governor.lastRaise < REVERT_WINDOW) {
+                k.upHold = std::min(MAX_UP_HOLD, k.upHold * 2.0);
+            }
+            changeKnob(governor, knob, k.level + 1, now, p50, p95);
+            governor.lowered.push_back(knob);
+            return true;
+        }
+        return false;
+    }
+
+    if (p95 >= governor.budget * governor.upThreshold || governor.lowered.empty()) {
+        governor.headroomSince = -1.0;
+        return false;
+    }
+    if (governor.headroomSince < 0.0) governor.headroomSince = now;
+    int knob = governor.lowered.back();
+    QualityKnob& k = governor.knobs[knob];
+    if (now - governor.headroomSince < k.upHold) return false;
+    changeKnob(governor, knob, k.level - 1, now, p50, p95);
+    governor.lowered.pop_back();
+    governor.lastRaised = knob;
+    governor.lastRaise = now;
+    return true;
+}
@@ -0,0 +1,52 @@
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+// Keeps the frame time inside its budget by stepping quality knobs down when the slow end of the
+// recent frame times runs over, and back up once there has been room to spare for a while.
+// Knobs go down in order and come back up in reverse, one step per decision. The gap between
+// the two thresholds, the hold after every change and a longer hold for a knob whose last step
+// up had to be taken back keep it from flipping between two levels.
+
+#include <cstddef>
+#include <vector>
+
+enum QualityKnobId {
+    KNOB_BITE_MARKS,      // BiteMarkDetail
+    KNOB_SPRINKLE_CAP,    // Most live sprinkles
+    KNOB_SPAWN_INTERVAL,  // Seconds between two sprinkles from the nozzle
+    KNOB_RENDER_SCALE,    // Scene resolution relative to the output
+    QUALITY_KNOB_COUNT
+};
+
+struct QualityKnob {
+    const char* name = "";
+    std::vector<float> levels; // Best first
+    int level = 0;
+    double upHold = 0.0;       // Seconds of headroom needed before stepping this knob back up
+};
+
+struct QualityGovernor {
+    double budget = 1.0 / 60.0;   // Seconds per frame
+    double downThreshold = 1.0;   // p95 above budget * this steps down
+    double upThreshold = 0.75;    // p95 below budget * this for a knob's upHold steps up
+    std::vector<double> samples;  // Ring of the latest frame times
+    size_t nextSample = 0;
+    size_t sampleCount = 0;       // Frames measured since the last change, up to samples.size()
+    double lastChange = 0.0;
+    double headroomSince = -1.0;  // When p95 last went below the up threshold; -1 while it isn't
+    std::vector<int> lowered;     // Knobs stepped down, most recent last
+    double lastRaise = -1.0e9;    // When lowered.back() was last stepped up
+    int lastRaised = -1;
+    QualityKnob knobs[QUALITY_KNOB_COUNT];
+};
+
+// Function declarations
+void initQualityGovernor(QualityGovernor& governor, double frameBudget, size_t windowFrames = 120);
+void setQualityKnob(QualityGovernor& governor, QualityKnobId knob, const char* name, const std::vector<float>& levels);
+// Adds one frame's working time (now in seconds); returns whether a knob changed, after logging it
+bool updateQualityGovernor(QualityGovernor& governor, double frameSeconds, double now);
+float qualityKnobValue(const QualityGovernor& governor, QualityKnobId knob);
+// p-th percentile (0..1) of the frame times in the window, in seconds
+double qualityPercentile(const QualityGovernor& governor, double p);
+
+#endif
@@ -0,0 +1,240 @@
+#include "Random.h"
+#include <random>
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define RANDOM_SSE2 1
+#endif
+
+// Constants
+static const uint32_t PHILOX_M0 = 0xD2511F53u;
+static const uint32_t PHILOX_M1 = 0xCD9E8D57u;
+static const uint32_t PHILOX_W0 = 0x9E3779B9u;
+static const uint32_t PHILOX_W1 = 0xBB67AE85u;
+static const int PHILOX_ROUNDS = 10;
+static const float UINT24_TO_UNIT = 1.0f / 16777216.0f;
+static const size_t CHUNK_BLOCKS = 64; // Blocks generated per pass of the bulk converters
+
+void initRandomStream(RandomStream& stream, uint64_t seed, uint32_t id) {
+    stream.key[0] = (uint32_t)seed;
+    stream.key[1] = (uint32_t)(seed >> 32);
+    stream.id = id;
+    stream.block = 0;
+    stream.bufferedCount = 0;
+}
+
+uint64_t randomSeedFromDevice() {
+    std::random_device rd;
+    return ((uint64_t)rd() << 32) | rd();
+}
+
+// Counter is (block low, block high, stream id, 0), key is the seed
+static void philoxBlock(const RandomStream& stream, uint64_t block, uint32_t out[4]) {
+    uint32_t c0 = (uint32_t)block, c1 = (uint32_t)(block >> 32), c2 = stream.id, c3 = 0;
+    uint32_t k0 = stream.key[0], k1 = stream.key[1];
+
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        uint64_t product0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t product1 = (uint64_t)PHILOX_M1 * c2;
+        c0 = (uint32_t)(product1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t)product1;
+        c2 = (uint32_t)(product0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t)product0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+#ifdef RANDOM_SSE2
+// 32x32 -> 64 bit multiply of every lane, split into low and high halves
+static inline void mulHiLo(__m128i a, __m128i multiplier, __m128i& lo, __m128i& hi) {
+    __m128i even = _mm_mul_epu32(a, multiplier);                     // lo0 hi0 lo2 hi2
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), multiplier);  // lo1 hi1 lo3 hi3
+    even = _mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 2, 0));         // lo0 lo2 hi0 hi2
+    odd = _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 2, 0));           // lo1 lo3 hi1 hi3
+    lo = _mm_unpacklo_epi32(even, odd);
+    hi = _mm_unpackhi_epi32(even, odd);
+}
+
+// Four consecutive blocks at once, one block per lane, written out in stream order
+static void philoxBlocks4(const RandomStream& stream, uint64_t block, uint32_t* out) {
+    __m128i c0 = _mm_set_epi32((int)(uint32_t)(block + 3), (int)(uint32_t)(block + 2),
+        (int)(uint32_t)(block + 1), (int)(uint32_t)block);
+    __m128i c1 = _mm_set_epi32((int)(uint32_t)((block + 3) >> 32), (int)(uint32_t)((block + 2) >> 32),
+        (int)(uint32_t)((block + 1) >> 32), (int)(uint32_t)(block >> 32));
+    __m128i c2 = _mm_set1_epi32((int)stream.id);
+    __m128i c3 = _mm_setzero_si128();
+    const __m128i m0 = _mm_set1_epi32((int)PHILOX_M0);
+    const __m128i m1 = _mm_set1_epi32((int)PHILOX_M1);
+    uint32_t k0 = stream.key[0], k1 = stream.key[1];
+
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        __m128i lo0, hi0, lo1, hi1;
+        mulHiLo(c0, m0, lo0, hi0);
+        mulHiLo(c2, m1, lo1, hi1);
+        c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32((int)k0));
+        c1 = lo1;
+        c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32((int)k1));
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    // Transpose word-per-register into block-per-register
+    __m128i t0 = _mm_unpacklo_epi32(c0, c1); // b0w0 b0w1 b1w0 b1w1
+    __m128i t1 = _mm_unpacklo_epi32(c2, c3); // b0w2 b0w3 b1w2 b1w3
+    __m128i t2 = _mm_unpackhi_epi32(c0, c1); // b2w0 b2w1 b3w0 b3w1
+    __m128i t3 = _mm_unpackhi_epi32(c2, c3); // b2w2 b2w3 b3w2 b3w3
+    _mm_storeu_si128((__m128i*)(out + 0), _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128((__m128i*)(out + 4), _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128((__m128i*)(out + 8), _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128((__m128i*)(out + 12), _mm_unpackhi_epi64(t2, t3));
+}
+#endif
+
+#if defined(__AVX2__)
+static inline void mulHiLo8(__m256i a, __m256i multiplier, __m256i& lo, __m256i& hi) {
+    __m256i even = _mm256_mul_epu32(a, multiplier);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), multiplier);
+    even = _mm256_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 2, 0));
+    odd = _mm256_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 2, 0));
+    lo = _mm256_unpacklo_epi32(even, odd);
+    hi = _mm256_unpackhi_epi32(even, odd);
+}
+
+// Same as philoxBlocks4 with eight blocks
+static void philoxBlocks8(const RandomStream& stream, uint64_t block, uint32_t* out) {
+    uint32_t counterLo[8], counterHi[8];
+    for (int n = 0; n < 8; n++) {
+        counterLo[n] = (uint32_t)(block + n);
+        counterHi[n] = (uint32_t)((block + n) >> 32);
+    }
+    __m256i c0 = _mm256_loadu_si256((const __m256i*)counterLo);
+    __m256i c1 = _mm256_loadu_si256((const __m256i*)counterHi);
+    __m256i c2 = _mm256_set1_epi32((int)stream.id);
+    __m256i c3 = _mm256_setzero_si256();
+    const __m256i m0 = _mm256_set1_epi32((int)PHILOX_M0);
+    const __m256i m1 = _mm256_set1_epi32((int)PHILOX_M1);
+    uint32_t k0 = stream.key[0], k1 = stream.key[1];
+
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        __m256i lo0, hi0, lo1, hi1;
+        mulHiLo8(c0, m0, lo0, hi0);
+        mulHiLo8(c2, m1, lo1, hi1);
+        c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32((int)k0));
+        c1 = lo1;
+        c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32((int)k1));
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    // Unpacks work per 128-bit half, giving blocks (0|4) (1|5) (2|6) (3|7); then swap halves
+    __m256i t0 = _mm256_unpacklo_epi32(c0, c1);
+    __m256i t1 = _mm256_unpacklo_epi32(c2, c3);
+    __m256i t2 = _mm256_unpackhi_epi32(c0, c1);
+    __m256i t3 = _mm256_unpackhi_epi32(c2, c3);
+    __m256i r0 = _mm256_unpacklo_epi64(t0, t1);
+    __m256i r1 = _mm256_unpackhi_epi64(t0, t1);
+    __m256i r2 = _mm256_unpacklo_epi64(t2, t3);
+    __m256i r3 = _mm256_unpackhi_epi64(t2, t3);
+    _mm256_storeu_si256((__m256i*)(out + 0), _mm256_permute2x128_si256(r0, r1, 0x20));
+    _mm256_storeu_si256((__m256i*)(out + 8), _mm256_permute2x128_si256(r2, r3, 0x20));
+    _mm256_storeu_si256((__m256i*)(out + 16), _mm256_permute2x128_si256(r0, r1, 0x31));
+    _mm256_storeu_si256((__m256i*)(out + 24), _mm256_permute2x128_si256(r2, r3, 0x31));
+}
+#endif
+
+// Writes 4 * blocks values and advances the stream past them
+static void generateBlocks(RandomStream& stream, uint32_t* out, size_t blocks) {
+    size_t n = 0;
+#if defined(__AVX2__)
+    for (; n + 8 <= blocks; n += 8) {
+        philoxBlocks8(stream, stream.block + n, out + 4 * n);
+    }
+#endif
+#ifdef RANDOM_SSE2
+    for (; n + 4 <= blocks; n += 4) {
+        philoxBlocks4(stream, stream.block + n, out + 4 * n);
+    }
+#endif
+    for (; n < blocks; n++) {
+        philoxBlock(stream, stream.block + n, out + 4 * n);
+    }
+    stream.block += blocks;
+}
+
+uint32_t randomUInt(RandomStream& stream) {
+    if (stream.bufferedCount == 0) {
+        philoxBlock(stream, stream.block++, stream.buffered);
+        stream.bufferedCount = 4;
+    }
+    return stream.buffered[4 - stream.bufferedCount--];
+}
+
+float randomFloat(RandomStream& stream, float min, float max) {
+    float scale = (max - min) * UINT24_TO_UNIT;
+    return min + (float)(randomUInt(stream) >> 8) * scale;
+}
+
+void fillRandomUInts(RandomStream& stream, uint32_t* out, size_t count) {
+    size_t done = 0;
+    while (done < count && stream.bufferedCount > 0) {
+        out[done++] = stream.buffered[4 - stream.bufferedCount--];
+    }
+    size_t fullBlocks = (count - done) / 4;
+    generateBlocks(stream, out + done, fullBlocks);
+    done += fullBlocks * 4;
+
+    // A partial last block is generated whole; what it doesn't use is kept for the next call
+    if (done < count) {
+        generateBlocks(stream, stream.buffered, 1);
+        stream.bufferedCount = 4;
+        while (done < count) {
+            out[done++] = stream.buffered[4 - stream.bufferedCount--];
+        }
+    }
+}
+
+void fillRandomFloats(RandomStream& stream, float* out, size_t count, float min, float max) {
+    uint32_t bits[CHUNK_BLOCKS * 4];
+    const float scale = (max - min) * UINT24_TO_UNIT;
+
+    for (size_t done = 0; done < count;) {
+        size_t n = count - done < CHUNK_BLOCKS * 4 ? count - done : CHUNK_BLOCKS * 4;
+        fillRandomUInts(stream, bits, n);
+
+        // Top 24 bits convert to float exactly, so every path rounds the same way
+        size_t i = 0;
+#ifdef RANDOM_SSE2
+        const __m128 minV = _mm_set1_ps(min);
+        const __m128 scaleV = _mm_set1_ps(scale);
+        for (; i + 4 <= n; i += 4) {
+            __m128i u = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(bits + i)), 8);
+            _mm_storeu_ps(out + done + i, _mm_add_ps(minV, _mm_mul_ps(_mm_cvtepi32_ps(u), scaleV)));
+        }
+#endif
+        for (; i < n; i++) {
+            out[done + i] = min + (float)(bits[i] >> 8) * scale;
+        }
+        done += n;
+    }
+}
+
+void fillRandomIndices(RandomStream& stream, uint8_t* out, size_t count, uint32_t range) {
+    uint32_t bits[CHUNK_BLOCKS * 4];
+
+    for (size_t done = 0; done < count;) {
+        size_t n = count - done < CHUNK_BLOCKS * 4 ? count - done : CHUNK_BLOCKS * 4;
+        fillRandomUInts(stream, bits, n);
+
+        // Multiply-high maps 32 random bits onto [0, range) without a division
+        for (size_t i = 0; i < n; i++) {
+            out[done + i] = (uint8_t)(((uint64_t)bits[i] * range) >> 32);
+        }
+        done += n;
+    }
+}
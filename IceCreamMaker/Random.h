@@ -0,0 +1,34 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Counter-based random numbers (Philox4x32-10). Value n of a stream is a pure function of
+// (seed, stream id, n), so streams never affect each other. Every call, single or bulk, takes
+// the next values in order, so splitting a fill into smaller ones returns the same values; a
+// run replays from its seed as long as it makes the same sequence of calls.
+struct RandomStream {
+    uint32_t key[2];        // Seed
+    uint32_t id;            // Stream id, part of the counter
+    uint64_t block;         // Next 4-value block to generate
+    uint32_t buffered[4];   // Leftovers of the last block a call only used part of; the next call starts with them
+    unsigned bufferedCount;
+};
+
+// Function declarations
+void initRandomStream(RandomStream& stream, uint64_t seed, uint32_t id);
+// Seed that differs between runs, for when nothing asked for a specific one
+uint64_t randomSeedFromDevice();
+
+// Single draws; fine for a handful per frame
+uint32_t randomUInt(RandomStream& stream);
+float randomFloat(RandomStream& stream, float min, float max);
+
+// Bulk draws, generated and converted several blocks at a time with SIMD where available.
+// Floats are uniform between min and max, indices uniform in [0, range).
+void fillRandomUInts(RandomStream& stream, uint32_t* out, size_t count);
+void fillRandomFloats(RandomStream& stream, float* out, size_t count, float min, float max);
+void fillRandomIndices(RandomStream& stream, uint8_t* out, size_t count, uint32_t range);
+
+#endif
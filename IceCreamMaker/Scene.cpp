@@ -0,0 +1,123 @@
+#include "Scene.h"
+
+const float BACKGROUND_COLOR[4] = { 0.392156862745098f, 0.4470588235294118f, 0.4901960784313725f, 1.0f };
+const size_t MAX_RECENT_BITE_MARKS = 16;
+
+void addSceneImages(SceneSprites& sprites) {
+    addAtlasImage(sprites.machineTexture, "res/machine.png");
+    addAtlasImage(sprites.leverVerticalTexture, "res/lever.png");
+    addAtlasImage(sprites.leverHorizontalTexture, "res/handle.png");
+    addAtlasImage(sprites.sprinklesCloseTexture, "res/sprinklesClose.png");
+    addAtlasImage(sprites.sprinklesOpenTexture, "res/sprinklesOpen.png");
+    addAtlasImage(sprites.vanillaPourTexture, "res/vanillaPour.png");
+    addAtlasImage(sprites.chocolatePourTexture, "res/chocolatePour.png");
+    addAtlasImage(sprites.mixedPourTexture, "res/mixedPour.png");
+    addAtlasImage(sprites.iceCreamVanillaTexture, "res/iceCreamVanilla.png");
+    addAtlasImage(sprites.iceCreamChocolateTexture, "res/iceCreamChocolate.png");
+    addAtlasImage(sprites.iceCreamMixedTexture, "res/iceCreamMixed.png");
+    addAtlasImage(sprites.cupFrontTexture, "res/cupFront.png");
+    addAtlasImage(sprites.cupBackTexture, "res/cupBack.png");
+    addAtlasImage(sprites.spoonTexture, "res/spoon.png");
+    addAtlasImage(sprites.circularTexture, "res/circle.png");
+    addAtlasImage(sprites.nameTexture, "res/nameTag.png");
+    addAtlasImage(sprites.glassTexture, "res/glass.png");
+}
+
+static void iceCreamLever(DrawList& list, const SceneSprites& sprites, int type, float leverPosition) {
+
+    float verticalScaleY = 1.0f - leverPosition * 0.7f;
+    float verticalPosY = (1.0f - verticalScaleY) * 0.4f;
+    float horizontalPosY = leverPosition * -0.2f;
+    float positionX = 0.0f;
+    switch (type) {
+    case 1: positionX = 0.0f; break;
+    case 2: positionX = 0.16f; break;
+    case 3: positionX = 0.31f; break;
+    }
+
+    addSprite(list, sprites.leverVerticalTexture, positionX, verticalPosY, 1.0f, verticalScaleY);
+    addSprite(list, sprites.leverHorizontalTexture, positionX, horizontalPosY, 1.0f, 1.0f);
+}
+
+static void drawIceCreamDrops(DrawList& list, const SceneSprites& sprites, const IceCreamState& iceCream, float alpha) {
+    for (const auto& drop : iceCream.drops) {
+        float posY = drop.prevPosY + (drop.posY - drop.prevPosY) * alpha;
+        if (drop.active && posY > CUP_TOP_POS_Y) {
+            const Sprite* texture = &sprites.vanillaPourTexture;
+            switch (drop.flavorType) {
+            case 1: texture = &sprites.vanillaPourTexture; break;
+            case 2: texture = &sprites.chocolatePourTexture; break;
+            case 3: texture = &sprites.mixedPourTexture; break;
+            }
+            addSprite(list, *texture,
+                0.0f, posY, DROP_WIDTH, drop.height);
+        }
+    }
+}
+
+// One fill layer, stretched from the bottom of the cup up to its level
+static void drawFillLayer(DrawList& list, const Sprite& texture, const CupFill& fill) {
+    if (fill.isFilled && fill.fillLevel > CUP_BOTTOM_POS_Y) {
+        float fillHeight = fill.fillLevel - CUP_BOTTOM_POS_Y;
+        float fillPosY = CUP_BOTTOM_POS_Y + (fillHeight / 2.0f);
+        addSprite(list, texture,
+            0.0f, fillPosY, CUP_FILL_WIDTH, fillHeight);
+    }
+}
+
+static void drawBiteMarks(DrawList& list, const Sprite& circleTexture, const std::vector<BiteMark>& biteMarks,
+    BiteMarkDetail detail) {
+    size_t first = 0;
+    if (detail == BITE_MARKS_RECENT && biteMarks.size() > MAX_RECENT_BITE_MARKS) first = biteMarks.size() - MAX_RECENT_BITE_MARKS;
+    for (size_t i = first; i < biteMarks.size(); i++) {
+        const BiteMark& bite = biteMarks[i];
+        addSprite(list, circleTexture, bite.x, bite.y, bite.size, bite.size);
+        // The circle's hull has hundreds of pieces, a lot of vertices for something this small
+        if (detail != BITE_MARKS_FULL) list.quads.back().hull = nullptr;
+    }
+}
+
+void buildScene(DrawList& list, const SimulationContext& simulation, const SceneSprites& sprites,
+    float alpha, float spoonX, float spoonY, float spoonSize, BiteMarkDetail biteMarkDetail) {
+    clearDrawList(list);
+
+    // Draw background elements first
+    addSprite(list, sprites.cupBackTexture, 0.0f, 0.0f, 1.0f, 1.0f);
+
+    // Draw the piled ice cream drops (inside the cup)
+    drawIceCreamDrops(list, sprites, simulation.iceCream, alpha);
+
+    // Draw the vanilla, chocolate and mixed fill layers
+    beginLayer(list, LAYER_CUP);
+    drawFillLayer(list, sprites.iceCreamVanillaTexture, simulation.iceCream.vanillaFill);
+    drawFillLayer(list, sprites.iceCreamChocolateTexture, simulation.iceCream.chocolateFill);
+    drawFillLayer(list, sprites.iceCreamMixedTexture, simulation.iceCream.mixedFill);
+
+    // Draw the machine and levers (on top of cup)
+    addSprite(list, sprites.machineTexture, 0.0f, 0.0f, 1.0f, 1.0f);
+    addSprite(list, sprites.nameTexture, 0.0f, 0.0f, 1.0f, 1.0f);
+    addSprite(list, sprites.cupFrontTexture, 0.0f, 0.0f, 1.0f, 1.0f);
+    endLayer(list);
+
+    addToppings(list);
+    addSprinkles(list, simulation.sprinkles, alpha);
+    drawBiteMarks(list, sprites.circularTexture, simulation.biteMarks, biteMarkDetail);
+
+    iceCreamLever(list, sprites, 1, simulation.levers.leverPositionVanilla);
+    iceCreamLever(list, sprites, 2, simulation.levers.leverPositionMixed);
+    iceCreamLever(list, sprites, 3, simulation.levers.leverPositionChocolate);
+
+    beginLayer(list, LAYER_DISPENSER);
+    if (simulation.sprinkles.open) {
+        addSprite(list, sprites.sprinklesOpenTexture, 0.0f, 0.0f, 1.0f, 1.0f);
+    }
+    else {
+        addSprite(list, sprites.sprinklesCloseTexture, 0.0f, 0.0f, 1.0f, 1.0f);
+    }
+
+    addSprite(list, sprites.glassTexture, 0.0f, 0.0f, 1.0f, 1.0f);
+    endLayer(list);
+
+    beginOverlay(list);
+    addSprite(list, sprites.spoonTexture, spoonX, spoonY, spoonSize, spoonSize);
+}
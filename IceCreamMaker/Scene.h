@@ -0,0 +1,55 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "Atlas.h"
+#include "DrawList.h"
+#include "Simulation.h"
+
+// Layer images, all packed into one atlas
+struct SceneSprites {
+    Sprite machineTexture;
+    Sprite leverVerticalTexture;
+    Sprite leverHorizontalTexture;
+    Sprite sprinklesOpenTexture;
+    Sprite sprinklesCloseTexture;
+    Sprite iceCreamVanillaTexture;
+    Sprite iceCreamChocolateTexture;
+    Sprite iceCreamMixedTexture;
+    Sprite vanillaPourTexture;
+    Sprite chocolatePourTexture;
+    Sprite mixedPourTexture;
+    Sprite cupFrontTexture;
+    Sprite cupBackTexture;
+    Sprite spoonTexture;
+    Sprite circularTexture;
+    Sprite nameTexture;
+    Sprite glassTexture;
+};
+
+// Layers that change only with the state they show, so a renderer can keep them composited
+enum SceneLayer {
+    LAYER_CUP,       // Fill layers, machine, name tag and cup front
+    LAYER_DISPENSER, // Sprinkle dispenser (open or closed) and glass
+    SCENE_LAYER_COUNT
+};
+
+// How much drawing the spoon's bite marks get; every level down is cheaper
+enum BiteMarkDetail {
+    BITE_MARKS_FULL,   // Every bite, split into its opaque and translucent parts
+    BITE_MARKS_SIMPLE, // Every bite as one blended quad
+    BITE_MARKS_RECENT, // Only the newest MAX_RECENT_BITE_MARKS, as one blended quad each
+    BITE_MARK_DETAIL_COUNT
+};
+
+// Constants
+extern const float BACKGROUND_COLOR[4];
+extern const size_t MAX_RECENT_BITE_MARKS;
+
+// Function declarations
+// Queues every layer image for the atlas; the sprites are valid after packAtlas()
+void addSceneImages(SceneSprites& sprites);
+// The whole machine for one frame, back to front, alpha of the way through the last step
+void buildScene(DrawList& list, const SimulationContext& simulation, const SceneSprites& sprites,
+    float alpha, float spoonX, float spoonY, float spoonSize, BiteMarkDetail biteMarkDetail = BITE_MARKS_FULL);
+
+#endif
@@ -0,0 +1,114 @@
+#include "Simulation.h"
+
+void initSimulation(SimulationContext& simulation, size_t sprinkleCapacity) {
+    simulation.levers = LeverState();
+    simulation.biteMarks.clear();
+    initSprinkles(simulation.sprinkles, sprinkleCapacity);
+    initIceCream(simulation.iceCream);
+}
+
+bool updateSimulation(SimulationContext& simulation, double stepTime) {
+    bool leversMoving = updateLevers(simulation.levers, (float)stepTime);
+    bool iceCreamMoving = updateIceCreamDrops(simulation.iceCream, (float)stepTime);
+    updateSprinklesPhysics(simulation.sprinkles, simulation.iceCream, stepTime);
+    return leversMoving || iceCreamMoving || sprinklesMoving(simulation.sprinkles);
+}
+
+void resetSimulation(SimulationContext& simulation) {
+    resetCup(simulation.iceCream);
+    resetSprinkles(simulation.sprinkles);
+    simulation.biteMarks.clear();
+}
+
+void toggleFlavor(SimulationContext& simulation, int flavorType) {
+    // Lever states (for animation)
+    switch (flavorType) {
+    case 1: simulation.levers.vanilla = !simulation.levers.vanilla; break;
+    case 2: simulation.levers.chocolate = !simulation.levers.chocolate; break;
+    case 3: simulation.levers.mixed = !simulation.levers.mixed; break;
+    default: return;
+    }
+    toggleIceCreamPour(simulation.iceCream, flavorType);
+}
+
+void toggleSprinkles(SimulationContext& simulation) {
+    simulation.sprinkles.open = !simulation.sprinkles.open;
+}
+
+// Removes one spoonful from a layer the spoon is on
+static void biteLayer(CupFill& fill) {
+    const float REDUCTION = 0.15f;
+
+    fill.fillLevel -= REDUCTION;
+    if (fill.fillLevel <= CUP_BOTTOM_POS_Y) {
+        fill.fillLevel = CUP_BOTTOM_POS_Y;
+        fill.isFilled = false;
+    }
+}
+
+// Whether (x, y) lands on the visible part of a layer
+static bool isOnLayer(const CupFill& fill, float x, float y) {
+    const float TEXTURE_SCALE = 0.35f; // Adjust this!
+    float scaledFill = CUP_BOTTOM_POS_Y + (fill.fillLevel - CUP_BOTTOM_POS_Y) * TEXTURE_SCALE;
+
+    return fill.isFilled &&
+        y < scaledFill &&
+        y > CUP_BOTTOM_POS_Y &&
+        x > 0.1f && x < 0.5f;
+}
+
+bool biteAt(SimulationContext& simulation, float x, float y) {
+    IceCreamState& iceCream = simulation.iceCream;
+    bool isOnVanilla = isOnLayer(iceCream.vanillaFill, x, y);
+    bool isOnChocolate = isOnLayer(iceCream.chocolateFill, x, y);
+    bool isOnMixed = isOnLayer(iceCream.mixedFill, x, y);
+
+    // Only add bite if clicking on actual ice cream
+    if (!isOnVanilla && !isOnChocolate && !isOnMixed) return false;
+
+    BiteMark bite;
+    bite.x = x;
+    bite.y = y;
+    bite.size = 0.05f;
+    simulation.biteMarks.push_back(bite);
+
+    if (isOnVanilla) biteLayer(iceCream.vanillaFill);
+    if (isOnChocolate) biteLayer(iceCream.chocolateFill);
+    if (isOnMixed) biteLayer(iceCream.mixedFill);
+
+    bool cupIsEmpty = !iceCream.vanillaFill.isFilled &&
+        !iceCream.chocolateFill.isFilled &&
+        !iceCream.mixedFill.isFilled;
+
+    if (cupIsEmpty) {
+        // Reset everything
+        resetSimulation(simulation);
+    }
+    return true;
+}
+
+// Lowers a filled layer by amount, stopping at the bottom of the cup
+static void meltLayer(CupFill& fill, float amount) {
+    if (!fill.isFilled) return;
+
+    fill.fillLevel -= amount;
+    if (fill.fillLevel < CUP_BOTTOM_POS_Y) {
+        fill.fillLevel = CUP_BOTTOM_POS_Y;
+    }
+}
+
+void reduceIceCreamFromBites(SimulationContext& simulation) {
+    if (simulation.biteMarks.empty()) return;
+
+    // Base reduction + extra per bite
+    float baseReduction = 0.001f;
+    float extraPerBite = 0.0005f;
+    float totalReduction = baseReduction + (extraPerBite * simulation.biteMarks.size());
+
+    // Cap maximum reduction
+    if (totalReduction > 0.01f) totalReduction = 0.01f;
+
+    meltLayer(simulation.iceCream.vanillaFill, totalReduction);
+    meltLayer(simulation.iceCream.chocolateFill, totalReduction);
+    meltLayer(simulation.iceCream.mixedFill, totalReduction);
+}
@@ -0,0 +1,39 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <vector>
+#include "Lever.h"
+#include "IceCream.h"
+#include "Sprinkles.h"
+
+// A spoon bite, drawn as a circle over the ice cream
+struct BiteMark {
+    float x, y;
+    float size;
+};
+
+// The whole machine: levers, pours, cup fills, sprinkles and bites. Nothing in here
+// touches GL, so it runs the same in the window and in the headless driver.
+struct SimulationContext {
+    LeverState levers;
+    IceCreamState iceCream;
+    SprinkleSystem sprinkles;
+    std::vector<BiteMark> biteMarks;
+};
+
+// Function declarations
+void initSimulation(SimulationContext& simulation, size_t sprinkleCapacity = DEFAULT_SPRINKLE_CAPACITY);
+// Advances everything that moves by exactly one fixed step; returns whether anything moved,
+// so the render loop can stop drawing once the machine is at rest
+bool updateSimulation(SimulationContext& simulation, double stepTime);
+// Empties the cup, the sprinkles and the bites
+void resetSimulation(SimulationContext& simulation);
+// Pulls or releases a flavor lever (1=vanilla, 2=chocolate, 3=mixed)
+void toggleFlavor(SimulationContext& simulation, int flavorType);
+void toggleSprinkles(SimulationContext& simulation);
+// Takes a spoonful at (x, y) if there is ice cream there; returns whether anything was bitten
+bool biteAt(SimulationContext& simulation, float x, float y);
+// Slowly melts every filled layer, faster the more bites it has
+void reduceIceCreamFromBites(SimulationContext& simulation);
+
+#endif
@@ -0,0 +1,212 @@
+// Renders the machine with the CPU rasterizer, no GL driver or display needed. Frames are
+// evenly spaced in simulation time like --headless, so a seeded run always produces the same
+// images and its checksum can be compared across thread counts, SIMD on/off and machines.
+// Built by the Makefile only; the Visual Studio project keeps Main.cpp as its single entry point.
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include "Scene.h"
+#include "SoftwareRenderer.h"
+#include "Timing.h"
+
+// FNV-1a over the frame's pixels
+static uint64_t hashPixels(uint64_t hash, const std::vector<uint32_t>& pixels) {
+    const unsigned char* bytes = (const unsigned char*)pixels.data();
+    for (size_t i = 0; i < pixels.size() * sizeof(uint32_t); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+int main(int argc, char** argv) {
+    // --size WxH: frame size (default 1280x720)
+    // --frames N: frames to render (default 300)
+    // --dump DIR: write every frame to DIR/frame_NNNNN.ppm
+    // --threads N: rasterizer threads, 0 = one per hardware thread
+    // --scalar: skip the SSE2 path
+    // --png: pack the atlas from the images even when a cooked one is there
+    // --seed N: fixed seed for every sprinkle random stream (default 1)
+    // --sim-hz N: simulation steps per second
+    // --fps N: simulated frame rate; each frame advances the simulation by 1/N seconds
+    // --pour vanilla|chocolate|mixed, --sprinkles: start with that lever pulled
+    // --render-scale S: draw the scene at S (0.25 to 1) times the frame size, scale it up, then draw the cursor
+    // --overdraw: also count the fragments per pixel the GL renderer writes, with and without its opaque/translucent split
+    int width = 1280, height = 720;
+    int frames = 300;
+    std::string dumpDirectory;
+    int threads = 0;
+    bool scalar = false;
+    bool packImages = false;
+    uint64_t seed = 1;
+    double simulationHz = 120.0;
+    double fps = 60.0;
+    bool pours[4] = { false, false, false, false };
+    bool sprinklesOpen = false;
+    bool overdraw = false;
+    float renderScale = 1.0f;
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--size" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                std::cout << "--size expects WxH, e.g. 1280x720" << std::endl;
+                return 1;
+            }
+        }
+        else if (option == "--frames" && i + 1 < argc) {
+            frames = std::stoi(argv[++i]);
+        }
+        else if (option == "--dump" && i + 1 < argc) {
+            dumpDirectory = argv[++i];
+        }
+        else if (option == "--threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        }
+        else if (option == "--scalar") {
+            scalar = true;
+        }
+        else if (option == "--png") {
+            packImages = true;
+        }
+        else if (option == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        }
+        else if (option == "--sim-hz" && i + 1 < argc) {
+            simulationHz = std::stod(argv[++i]);
+        }
+        else if (option == "--fps" && i + 1 < argc) {
+            fps = std::stod(argv[++i]);
+        }
+        else if (option == "--pour" && i + 1 < argc) {
+            std::string flavor = argv[++i];
+            if (flavor == "vanilla") pours[1] = true;
+            else if (flavor == "chocolate") pours[2] = true;
+            else if (flavor == "mixed") pours[3] = true;
+            else {
+                std::cout << "Unknown flavor: " << flavor << std::endl;
+                return 1;
+            }
+        }
+        else if (option == "--sprinkles") {
+            sprinklesOpen = true;
+        }
+        else if (option == "--overdraw") {
+            overdraw = true;
+        }
+        else if (option == "--render-scale" && i + 1 < argc) {
+            renderScale = std::stof(argv[++i]);
+            if (!(renderScale >= 0.25f && renderScale <= 1.0f)) {
+                std::cout << "--render-scale expects a value from 0.25 to 1" << std::endl;
+                return 1;
+            }
+        }
+        else {
+            std::cout << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+    if (simulationHz <= 0.0 || fps <= 0.0) {
+        std::cout << "--sim-hz and --fps must be positive" << std::endl;
+        return 1;
+    }
+
+    SimulationContext simulation;
+    initSimulation(simulation);
+    seedSprinkles(simulation.sprinkles, seed);
+    for (int flavorType = 1; flavorType <= 3; flavorType++) {
+        if (pours[flavorType]) toggleFlavor(simulation, flavorType);
+    }
+    if (sprinklesOpen) toggleSprinkles(simulation);
+
+    openAssetPack(ASSET_PACK_PATH);
+    // Same atlas the GL path uploads, kept in memory instead; only level 0 is sampled
+    SceneSprites sprites;
+    addSceneImages(sprites);
+    std::vector<unsigned char> atlasPixels;
+    TextureFile cooked;
+    if (!packImages && loadCookedAtlas(COOKED_ATLAS_PATH, cooked)) {
+        const AssetSpan& level = cooked.levels[0];
+        if (cooked.format == TEXTURE_BC3) decompressBC3(level.data, cooked.width, cooked.height, atlasPixels);
+        else atlasPixels.assign(level.data, level.data + level.size);
+        std::cout << "Atlas: " << COOKED_ATLAS_PATH << std::endl;
+    }
+    else if (!packAtlas(atlasPixels, 16384)) {
+        std::cout << "Failed to build texture atlas" << std::endl;
+        return 1;
+    }
+    SoftwareImage atlas;
+    softwareImageFromRGBA(atlas, atlasWidth, atlasHeight, atlasPixels);
+
+    initSoftwareRenderer(threads);
+    setSoftwareSimd(!scalar);
+    const float aspect = (float)width / height;
+    SoftwareImage frame;
+    initSoftwareImage(frame, width, height);
+    // Same as the GL renderer's scene target
+    SoftwareImage scene;
+    if (renderScale < 1.0f) {
+        initSoftwareImage(scene, std::max(1, (int)(width * renderScale + 0.5f)), std::max(1, (int)(height * renderScale + 0.5f)));
+        std::cout << "Render scale: " << renderScale << ", scene drawn at " << scene.width << "x" << scene.height << std::endl;
+    }
+    SoftwareToppings toppings;
+    initSoftwareToppings(toppings, width, height, simulation.sprinkles);
+
+    FixedStepClock clock;
+    initFixedStepClock(clock, simulationHz, 8);
+    DrawList drawList;
+    std::vector<unsigned char> framePixels;
+    uint64_t checksum = 14695981039346656037ULL;
+    double renderTime = 0.0;
+    std::vector<uint16_t> overdrawCounts;
+    double overdrawInOrder = 0.0, overdrawSplit = 0.0;
+    for (int frameIndex = 0; frameIndex < frames; frameIndex++) {
+        int steps = advanceFixedStepClock(clock, 1.0 / fps);
+        for (int step = 0; step < steps; step++) {
+            updateSimulation(simulation, clock.stepSize);
+        }
+        float alpha = fixedStepAlpha(clock);
+
+        double startTime = timingNow();
+        bakeSoftwareToppings(toppings, simulation.sprinkles, aspect);
+        buildScene(drawList, simulation, sprites, alpha, 0.0f, 0.0f, 0.2f);
+        if (renderScale < 1.0f) {
+            size_t overlayStart = firstOverlayCommand(drawList);
+            clearSoftwareImage(scene, BACKGROUND_COLOR);
+            renderSoftwareCommands(scene, drawList, 0, overlayStart, atlas, toppings, aspect);
+            upscaleSoftwareImage(frame, scene);
+            renderSoftwareCommands(frame, drawList, overlayStart, drawList.commands.size(), atlas, toppings, aspect);
+        }
+        else {
+            clearSoftwareImage(frame, BACKGROUND_COLOR);
+            renderSoftwareDrawList(frame, drawList, atlas, toppings, aspect);
+        }
+        renderTime += timingNow() - startTime;
+        if (overdraw) {
+            overdrawInOrder += measureSoftwareOverdraw(width, height, drawList, toppings, aspect, false, overdrawCounts);
+            overdrawSplit += measureSoftwareOverdraw(width, height, drawList, toppings, aspect, true, overdrawCounts);
+        }
+
+        checksum = hashPixels(checksum, frame.pixels);
+        if (!dumpDirectory.empty()) {
+            char path[64];
+            std::snprintf(path, sizeof(path), "/frame_%05d.ppm", frameIndex);
+            readSoftwareImage(frame, framePixels);
+            writePPM(dumpDirectory + path, width, height, framePixels);
+        }
+    }
+    int threadCount = getSoftwareThreadCount();
+    destroySoftwareRenderer();
+
+    std::cout << "Software: " << frames << " frames at " << width << "x" << height << " on "
+        << threadCount << " threads, "
+        << (scalar || !isSoftwareSimdAvailable() ? "scalar" : "SSE2") << ", "
+        << (frames > 0 ? renderTime * 1000.0 / frames : 0.0) << " ms/frame" << std::endl;
+    std::cout << "Sprinkles: " << simulation.sprinkles.store.count() << " live" << std::endl;
+    if (overdraw && frames > 0) {
+        std::cout << "Overdraw: " << overdrawInOrder / frames << " fragments per pixel in order, "
+            << overdrawSplit / frames << " with the opaque/translucent split" << std::endl;
+    }
+    std::cout << "Checksum: " << std::hex << checksum << std::dec << std::endl;
+    return 0;
+}
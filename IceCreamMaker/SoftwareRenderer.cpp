@@ -0,0 +1,573 @@
+#include "SoftwareRenderer.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_SSE2 1
+#endif
+
+// Square tiles small enough to stay in L1/L2 while every item touching them is drawn
+static const int TILE_SIZE = 64;
+
+enum RasterItemType {
+    ITEM_QUAD,
+    ITEM_CIRCLE
+};
+
+// One primitive already in target pixels; covers the pixel centers in [x0, x1) x [y0, y1)
+struct RasterItem {
+    RasterItemType type;
+    int x0, y0, x1, y1;
+    // Quad: texel coordinate (GL_LINEAR, texel centers at .5) is base + pixel * step
+    const SoftwareImage* texture;
+    float sBase, sStep, tBase, tStep;
+    // Circle: center and inverse radii in pixels, plus its opaque color
+    float centerX, centerY, invRadiusX, invRadiusY;
+    uint32_t color;
+};
+
+static std::vector<RasterItem> rasterItems;
+static std::vector<std::vector<uint32_t>> tileBins;
+static std::vector<SprinkleInstance> bakeInstances;
+// measureSoftwareOverdraw(): covered areas and the frame item (depth order) each belongs to
+static std::vector<RasterItem> overdrawOpaque, overdrawTranslucent;
+static std::vector<size_t> overdrawOpaqueItems, overdrawTranslucentItems;
+static std::vector<int> overdrawDepth;
+static SoftwareImage* rasterTarget = nullptr;
+static int tilesX = 0, tileCount = 0;
+static bool useSimd = true;
+
+// Worker pool: every render bumps the generation, workers and the caller then pull tiles
+static std::vector<std::thread> workers;
+static std::mutex poolMutex;
+static std::condition_variable poolWake;
+static std::condition_variable poolDone;
+static unsigned int jobGeneration = 0;
+static int workersBusy = 0;
+static bool stopping = false;
+static std::atomic<int> nextTile(0);
+
+// Toppings layer placement, same as Toppings.cpp
+static const float CENTER_X = (TOPPINGS_LEFT + TOPPINGS_RIGHT) * 0.5f;
+static const float CENTER_Y = (TOPPINGS_BOTTOM + TOPPINGS_TOP) * 0.5f;
+static const float HALF_WIDTH = (TOPPINGS_RIGHT - TOPPINGS_LEFT) * 0.5f;
+static const float HALF_HEIGHT = (TOPPINGS_TOP - TOPPINGS_BOTTOM) * 0.5f;
+
+static int clampPixel(float value, int limit) {
+    if (!(value > 0.0f)) return 0;
+    if (value >= (float)limit) return limit;
+    return (int)value;
+}
+
+static int clampIndex(int value, int limit) {
+    return value < 0 ? 0 : (value >= limit ? limit - 1 : value);
+}
+
+// GL's unorm conversion of a color channel
+static uint32_t toUnorm(float value) {
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    return (uint32_t)(value * 255.0f + 0.5f);
+}
+
+static uint32_t packColor(float r, float g, float b, float a) {
+    return toUnorm(r) | (toUnorm(g) << 8) | (toUnorm(b) << 16) | (toUnorm(a) << 24);
+}
+
+static float channel(uint32_t pixel, int index) {
+    return (float)((pixel >> (index * 8)) & 255);
+}
+
+// Bilinear sample of four texels blended over *dst with SRC_ALPHA, ONE_MINUS_SRC_ALPHA
+static void blendBilinearScalar(uint32_t* dst, uint32_t a, uint32_t b, uint32_t c, uint32_t d, float fx, float fy) {
+    float v[4];
+    for (int i = 0; i < 4; i++) {
+        float top = channel(a, i) + (channel(b, i) - channel(a, i)) * fx;
+        float bottom = channel(c, i) + (channel(d, i) - channel(c, i)) * fx;
+        v[i] = top + (bottom - top) * fy;
+    }
+    float alpha = v[3] * (1.0f / 255.0f);
+    float inverse = 1.0f - alpha;
+    uint32_t result = 0;
+    for (int i = 0; i < 4; i++) {
+        float blended = v[i] * alpha + channel(*dst, i) * inverse + 0.5f;
+        result |= (uint32_t)std::min((int)blended, 255) << (i * 8);
+    }
+    *dst = result;
+}
+
+#ifdef SOFTWARE_SSE2
+static inline __m128 unpackPixel(uint32_t pixel) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_cvtsi32_si128((int)pixel);
+    v = _mm_unpacklo_epi8(v, zero);
+    v = _mm_unpacklo_epi16(v, zero);
+    return _mm_cvtepi32_ps(v);
+}
+
+// Same operations in the same order as blendBilinearScalar, all four channels at once
+static void blendBilinearSse2(uint32_t* dst, uint32_t a, uint32_t b, uint32_t c, uint32_t d, float fx, float fy) {
+    __m128 pa = unpackPixel(a), pb = unpackPixel(b), pc = unpackPixel(c), pd = unpackPixel(d);
+    __m128 fxv = _mm_set1_ps(fx);
+    __m128 top = _mm_add_ps(pa, _mm_mul_ps(_mm_sub_ps(pb, pa), fxv));
+    __m128 bottom = _mm_add_ps(pc, _mm_mul_ps(_mm_sub_ps(pd, pc), fxv));
+    __m128 v = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), _mm_set1_ps(fy)));
+    __m128 alpha = _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), _mm_set1_ps(1.0f / 255.0f));
+    __m128 inverse = _mm_sub_ps(_mm_set1_ps(1.0f), alpha);
+    __m128 blended = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v, alpha), _mm_mul_ps(unpackPixel(*dst), inverse)), _mm_set1_ps(0.5f));
+    __m128i result = _mm_cvttps_epi32(blended);
+    result = _mm_packs_epi32(result, result);
+    result = _mm_packus_epi16(result, result);
+    *dst = (uint32_t)_mm_cvtsi128_si32(result);
+}
+#endif
+
+static void drawQuadSpan(const RasterItem& item, uint32_t* row, int y, int x0, int x1) {
+    const SoftwareImage& texture = *item.texture;
+    float t = item.tBase + (float)y * item.tStep;
+    float tFloor = std::floor(t);
+    float fy = t - tFloor;
+    int ty = (int)tFloor;
+    const uint32_t* row0 = &texture.pixels[(size_t)clampIndex(ty, texture.height) * texture.width];
+    const uint32_t* row1 = &texture.pixels[(size_t)clampIndex(ty + 1, texture.height) * texture.width];
+#ifdef SOFTWARE_SSE2
+    const bool simd = useSimd;
+#endif
+
+    for (int x = x0; x < x1; x++) {
+        float s = item.sBase + (float)x * item.sStep;
+        float sFloor = std::floor(s);
+        float fx = s - sFloor;
+        int tx = (int)sFloor;
+        int c0 = clampIndex(tx, texture.width), c1 = clampIndex(tx + 1, texture.width);
+        uint32_t a = row0[c0], b = row0[c1], c = row1[c0], d = row1[c1];
+        // Fully transparent texels leave the pixel as it was
+        if (((a | b | c | d) >> 24) == 0) continue;
+#ifdef SOFTWARE_SSE2
+        if (simd) {
+            blendBilinearSse2(&row[x], a, b, c, d, fx, fy);
+            continue;
+        }
+#endif
+        blendBilinearScalar(&row[x], a, b, c, d, fx, fy);
+    }
+}
+
+// particle.frag: keep pixels within the circle, written opaque
+static void drawCircleSpan(const RasterItem& item, uint32_t* row, int y, int x0, int x1) {
+    float dy = ((float)y + 0.5f - item.centerY) * item.invRadiusY;
+    float dy2 = dy * dy;
+    if (dy2 > 1.0f) return;
+    int x = x0;
+#ifdef SOFTWARE_SSE2
+    if (useSimd) {
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 center = _mm_set1_ps(item.centerX);
+        const __m128 invRadius = _mm_set1_ps(item.invRadiusX);
+        const __m128 dyv = _mm_set1_ps(dy2);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128i color = _mm_set1_epi32((int)item.color);
+        const __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+        for (; x + 4 <= x1; x += 4) {
+            __m128 px = _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x), lanes)), half);
+            __m128 dx = _mm_mul_ps(_mm_sub_ps(px, center), invRadius);
+            __m128 inside = _mm_cmple_ps(_mm_add_ps(_mm_mul_ps(dx, dx), dyv), one);
+            __m128i mask = _mm_castps_si128(inside);
+            __m128i old = _mm_loadu_si128((const __m128i*)&row[x]);
+            __m128i result = _mm_or_si128(_mm_and_si128(mask, color), _mm_andnot_si128(mask, old));
+            _mm_storeu_si128((__m128i*)&row[x], result);
+        }
+    }
+#endif
+    for (; x < x1; x++) {
+        float dx = ((float)x + 0.5f - item.centerX) * item.invRadiusX;
+        if (dx * dx + dy2 <= 1.0f) row[x] = item.color;
+    }
+}
+
+static void rasterizeTile(int tile) {
+    SoftwareImage& target = *rasterTarget;
+    int tileX0 = (tile % tilesX) * TILE_SIZE;
+    int tileY0 = (tile / tilesX) * TILE_SIZE;
+    int tileX1 = std::min(tileX0 + TILE_SIZE, target.width);
+    int tileY1 = std::min(tileY0 + TILE_SIZE, target.height);
+
+    for (uint32_t index : tileBins[tile]) {
+        const RasterItem& item = rasterItems[index];
+        int x0 = std::max(item.x0, tileX0), x1 = std::min(item.x1, tileX1);
+        int y0 = std::max(item.y0, tileY0), y1 = std::min(item.y1, tileY1);
+        for (int y = y0; y < y1; y++) {
+            uint32_t* row = &target.pixels[(size_t)y * target.width];
+            if (item.type == ITEM_QUAD) drawQuadSpan(item, row, y, x0, x1);
+            else drawCircleSpan(item, row, y, x0, x1);
+        }
+    }
+}
+
+static void runTiles() {
+    for (int tile = nextTile.fetch_add(1); tile < tileCount; tile = nextTile.fetch_add(1)) {
+        rasterizeTile(tile);
+    }
+}
+
+static void workerLoop() {
+    unsigned int seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            poolWake.wait(lock, [&] { return stopping || jobGeneration != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = jobGeneration;
+        }
+        runTiles();
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            if (--workersBusy == 0) poolDone.notify_one();
+        }
+    }
+}
+
+// Bins rasterItems into the target's tiles and draws them
+static void rasterizeItems(SoftwareImage& target) {
+    if (rasterItems.empty() || target.width <= 0 || target.height <= 0) return;
+
+    tilesX = (target.width + TILE_SIZE - 1) / TILE_SIZE;
+    int tilesY = (target.height + TILE_SIZE - 1) / TILE_SIZE;
+    tileCount = tilesX * tilesY;
+    if ((int)tileBins.size() < tileCount) tileBins.resize(tileCount);
+    for (int i = 0; i < tileCount; i++) tileBins[i].clear();
+
+    for (size_t i = 0; i < rasterItems.size(); i++) {
+        const RasterItem& item = rasterItems[i];
+        int firstX = item.x0 / TILE_SIZE, lastX = (item.x1 - 1) / TILE_SIZE;
+        int firstY = item.y0 / TILE_SIZE, lastY = (item.y1 - 1) / TILE_SIZE;
+        for (int ty = firstY; ty <= lastY; ty++) {
+            for (int tx = firstX; tx <= lastX; tx++) tileBins[ty * tilesX + tx].push_back((uint32_t)i);
+        }
+    }
+
+    rasterTarget = &target;
+    nextTile = 0;
+    if (workers.empty()) {
+        runTiles();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        workersBusy = (int)workers.size();
+        jobGeneration++;
+    }
+    poolWake.notify_all();
+    runTiles();
+    std::unique_lock<std::mutex> lock(poolMutex);
+    poolDone.wait(lock, [] { return workersBusy == 0; });
+}
+
+static void addQuadItem(const SoftwareImage& target, const SoftwareImage& texture,
+    float left, float bottom, float right, float top, float u0, float v0, float u1, float v1) {
+    if (texture.pixels.empty()) return;
+
+    // NDC to pixels; a mirrored quad samples its texture the other way round
+    float px0 = (left + 1.0f) * 0.5f * target.width, px1 = (right + 1.0f) * 0.5f * target.width;
+    float py0 = (bottom + 1.0f) * 0.5f * target.height, py1 = (top + 1.0f) * 0.5f * target.height;
+    if (px0 > px1) { std::swap(px0, px1); std::swap(u0, u1); }
+    if (py0 > py1) { std::swap(py0, py1); std::swap(v0, v1); }
+
+    RasterItem item = {};
+    item.type = ITEM_QUAD;
+    item.x0 = clampPixel(std::ceil(px0 - 0.5f), target.width);
+    item.x1 = clampPixel(std::ceil(px1 - 0.5f), target.width);
+    item.y0 = clampPixel(std::ceil(py0 - 0.5f), target.height);
+    item.y1 = clampPixel(std::ceil(py1 - 0.5f), target.height);
+    if (item.x0 >= item.x1 || item.y0 >= item.y1) return;
+
+    item.texture = &texture;
+    item.sStep = (u1 - u0) * texture.width / (px1 - px0);
+    item.sBase = u0 * texture.width - 0.5f + (0.5f - px0) * item.sStep;
+    item.tStep = (v1 - v0) * texture.height / (py1 - py0);
+    item.tBase = v0 * texture.height - 0.5f + (0.5f - py0) * item.tStep;
+    rasterItems.push_back(item);
+}
+
+// Sprinkles as particle.vert places them, seen through a view (center xy, half size zw)
+static void addCircleItems(const SoftwareImage& target, const SprinkleInstance* instances, size_t count,
+    float aspect, float viewX, float viewY, float viewHalfWidth, float viewHalfHeight) {
+    float pixelsPerUnitX = 0.5f * target.width / viewHalfWidth;
+    float pixelsPerUnitY = 0.5f * target.height / viewHalfHeight;
+    for (size_t i = 0; i < count; i++) {
+        const SprinkleInstance& instance = instances[i];
+        // The circle is round in square space, so its rotation does not matter
+        float radiusX = 0.5f * instance.size / aspect * pixelsPerUnitX;
+        float radiusY = 0.5f * instance.size * pixelsPerUnitY;
+        if (!(radiusX > 0.0f) || !(radiusY > 0.0f)) continue;
+
+        RasterItem item = {};
+        item.type = ITEM_CIRCLE;
+        item.centerX = (instance.x - viewX + viewHalfWidth) * pixelsPerUnitX;
+        item.centerY = (instance.y - viewY + viewHalfHeight) * pixelsPerUnitY;
+        item.x0 = clampPixel(std::floor(item.centerX - radiusX), target.width);
+        item.x1 = clampPixel(std::ceil(item.centerX + radiusX) + 1.0f, target.width);
+        item.y0 = clampPixel(std::floor(item.centerY - radiusY), target.height);
+        item.y1 = clampPixel(std::ceil(item.centerY + radiusY) + 1.0f, target.height);
+        if (item.x0 >= item.x1 || item.y0 >= item.y1) continue;
+
+        item.invRadiusX = 1.0f / radiusX;
+        item.invRadiusY = 1.0f / radiusY;
+        item.color = packColor(instance.color[0], instance.color[1], instance.color[2], 1.0f);
+        rasterItems.push_back(item);
+    }
+}
+
+void initSoftwareRenderer(int threadCount) {
+    destroySoftwareRenderer();
+    if (threadCount <= 0) threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+    stopping = false;
+    for (int i = 1; i < threadCount; i++) workers.push_back(std::thread(workerLoop));
+}
+
+int getSoftwareThreadCount() {
+    return (int)workers.size() + 1;
+}
+
+void setSoftwareSimd(bool enabled) {
+    useSimd = enabled;
+}
+
+bool isSoftwareSimdAvailable() {
+#ifdef SOFTWARE_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+void destroySoftwareRenderer() {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stopping = true;
+    }
+    poolWake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+}
+
+void initSoftwareImage(SoftwareImage& image, int width, int height) {
+    image.width = width;
+    image.height = height;
+    image.pixels.assign((size_t)width * height, 0);
+}
+
+void softwareImageFromRGBA(SoftwareImage& image, int width, int height, const std::vector<unsigned char>& rgba) {
+    initSoftwareImage(image, width, height);
+    for (size_t i = 0; i < image.pixels.size(); i++) {
+        const unsigned char* p = &rgba[i * 4];
+        image.pixels[i] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+}
+
+void clearSoftwareImage(SoftwareImage& image, const float color[4]) {
+    std::fill(image.pixels.begin(), image.pixels.end(), packColor(color[0], color[1], color[2], color[3]));
+}
+
+void readSoftwareImage(const SoftwareImage& image, std::vector<unsigned char>& rgb) {
+    rgb.resize((size_t)image.width * image.height * 3);
+    unsigned char* out = rgb.data();
+    for (int y = image.height - 1; y >= 0; y--) {
+        const uint32_t* row = &image.pixels[(size_t)y * image.width];
+        for (int x = 0; x < image.width; x++) {
+            *out++ = (unsigned char)(row[x] & 255);
+            *out++ = (unsigned char)((row[x] >> 8) & 255);
+            *out++ = (unsigned char)((row[x] >> 16) & 255);
+        }
+    }
+}
+
+void initSoftwareToppings(SoftwareToppings& toppings, int screenWidth, int screenHeight, const SprinkleSystem& sprinkles) {
+    // Same pixel density as the screen, like the GL layer
+    initSoftwareImage(toppings.image, (int)(HALF_WIDTH * screenWidth + 0.5f), (int)(HALF_HEIGHT * screenHeight + 0.5f));
+    toppings.bakedResetCount = sprinkles.resetCount;
+    toppings.empty = true;
+}
+
+void bakeSoftwareToppings(SoftwareToppings& toppings, SprinkleSystem& sprinkles, float aspect) {
+    if (toppings.bakedResetCount != sprinkles.resetCount) {
+        toppings.bakedResetCount = sprinkles.resetCount;
+        if (!toppings.empty) {
+            std::fill(toppings.image.pixels.begin(), toppings.image.pixels.end(), 0);
+            toppings.empty = true;
+        }
+    }
+    if (sprinkles.settled.empty()) return;
+
+    buildSettledInstances(sprinkles, bakeInstances);
+    sprinkles.settled.clear();
+
+    rasterItems.clear();
+    addCircleItems(toppings.image, bakeInstances.data(), bakeInstances.size(), aspect,
+        CENTER_X, CENTER_Y, HALF_WIDTH, HALF_HEIGHT);
+    rasterizeItems(toppings.image);
+    toppings.empty = false;
+}
+
+void renderSoftwareDrawList(SoftwareImage& target, const DrawList& list, const SoftwareImage& atlas,
+    const SoftwareToppings& toppings, float aspect) {
+    renderSoftwareCommands(target, list, 0, list.commands.size(), atlas, toppings, aspect);
+}
+
+void renderSoftwareCommands(SoftwareImage& target, const DrawList& list, size_t firstCommand, size_t endCommand,
+    const SoftwareImage& atlas, const SoftwareToppings& toppings, float aspect) {
+    rasterItems.clear();
+    for (size_t c = firstCommand; c < endCommand; c++) {
+        const DrawCommand& command = list.commands[c];
+        switch (command.type) {
+        case DRAW_SPRITES:
+            for (size_t i = command.first; i < command.first + command.count; i++) {
+                const SpriteQuad& q = list.quads[i];
+                addQuadItem(target, atlas, q.left, q.bottom, q.right, q.top, q.u0, q.v0, q.u1, q.v1);
+            }
+            break;
+        case DRAW_SPRINKLES:
+            addCircleItems(target, list.sprinkles.data() + command.first, command.count, aspect, 0.0f, 0.0f, 1.0f, 1.0f);
+            break;
+        case DRAW_TOPPINGS:
+            if (!toppings.empty) {
+                addQuadItem(target, toppings.image, TOPPINGS_LEFT, TOPPINGS_BOTTOM, TOPPINGS_RIGHT, TOPPINGS_TOP,
+                    0.0f, 0.0f, 1.0f, 1.0f);
+            }
+            break;
+        case DRAW_LAYER:
+            // Tiles already skip work that doesn't touch them, so the layer's sprites are drawn in place
+            break;
+        }
+    }
+    rasterizeItems(target);
+}
+
+void upscaleSoftwareImage(SoftwareImage& target, const SoftwareImage& source) {
+    // Blending an opaque source over anything leaves just the source
+    rasterItems.clear();
+    addQuadItem(target, source, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+    rasterizeItems(target);
+}
+
+// Pixel centers inside an NDC rectangle, as a quad item without a texture
+static RasterItem overdrawRect(int width, int height, float left, float bottom, float right, float top) {
+    RasterItem item = {};
+    item.type = ITEM_QUAD;
+    item.x0 = clampPixel(std::ceil((left + 1.0f) * 0.5f * width - 0.5f), width);
+    item.x1 = clampPixel(std::ceil((right + 1.0f) * 0.5f * width - 0.5f), width);
+    item.y0 = clampPixel(std::ceil((bottom + 1.0f) * 0.5f * height - 0.5f), height);
+    item.y1 = clampPixel(std::ceil((top + 1.0f) * 0.5f * height - 0.5f), height);
+    return item;
+}
+
+static bool overdrawCovers(const RasterItem& item, int x, int y) {
+    if (item.type == ITEM_QUAD) return true;
+    float dx = ((float)x + 0.5f - item.centerX) * item.invRadiusX;
+    float dy = ((float)y + 0.5f - item.centerY) * item.invRadiusY;
+    return dx * dx + dy * dy <= 1.0f;
+}
+
+static void addOverdrawPart(int width, int height, const SpriteQuad& quad, const HullRect& part,
+    size_t item, std::vector<RasterItem>& pieces, std::vector<size_t>& items) {
+    float quadWidth = quad.right - quad.left, quadHeight = quad.top - quad.bottom;
+    pieces.push_back(overdrawRect(width, height, quad.left + part.x0 * quadWidth, quad.bottom + part.y0 * quadHeight,
+        quad.left + part.x1 * quadWidth, quad.bottom + part.y1 * quadHeight));
+    items.push_back(item);
+}
+
+double measureSoftwareOverdraw(int width, int height, const DrawList& list, const SoftwareToppings& toppings,
+    float aspect, bool split, std::vector<uint16_t>& counts) {
+    static const HullRect WHOLE = { 0.0f, 0.0f, 1.0f, 1.0f };
+    overdrawOpaque.clear();
+    overdrawTranslucent.clear();
+    overdrawOpaqueItems.clear();
+    overdrawTranslucentItems.clear();
+    SoftwareImage target;
+    target.width = width;
+    target.height = height;
+    SpriteHull layerHull;
+    const SpriteQuad screen = { -1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, nullptr };
+
+    // Same items as the GL drawFrameSplit(); without the split everything is "translucent", in order
+    size_t item = 0;
+    for (size_t c = 0; c < list.commands.size(); c++) {
+        const DrawCommand& command = list.commands[c];
+        switch (command.type) {
+        case DRAW_SPRITES:
+            for (size_t i = command.first; i < command.first + command.count; i++, item++) {
+                const SpriteQuad& quad = list.quads[i];
+                if (!split || !quad.hull) {
+                    addOverdrawPart(width, height, quad, WHOLE, item, overdrawTranslucent, overdrawTranslucentItems);
+                    continue;
+                }
+                for (const HullRect& part : quad.hull->opaque) addOverdrawPart(width, height, quad, part, item, overdrawOpaque, overdrawOpaqueItems);
+                for (const HullRect& part : quad.hull->translucent) addOverdrawPart(width, height, quad, part, item, overdrawTranslucent, overdrawTranslucentItems);
+            }
+            break;
+        case DRAW_SPRINKLES:
+            rasterItems.clear();
+            addCircleItems(target, list.sprinkles.data() + command.first, command.count, aspect, 0.0f, 0.0f, 1.0f, 1.0f);
+            for (const RasterItem& circle : rasterItems) {
+                (split ? overdrawOpaque : overdrawTranslucent).push_back(circle);
+                (split ? overdrawOpaqueItems : overdrawTranslucentItems).push_back(item);
+            }
+            item++;
+            break;
+        case DRAW_TOPPINGS:
+            if (!toppings.empty) {
+                overdrawTranslucent.push_back(overdrawRect(width, height, TOPPINGS_LEFT, TOPPINGS_BOTTOM, TOPPINGS_RIGHT, TOPPINGS_TOP));
+                overdrawTranslucentItems.push_back(item);
+            }
+            item++;
+            break;
+        case DRAW_LAYER:
+            if (!split) {
+                addOverdrawPart(width, height, screen, WHOLE, item, overdrawTranslucent, overdrawTranslucentItems);
+            }
+            else {
+                buildLayerHull(list, c + 1, command.count, width, height, layerHull);
+                for (const HullRect& part : layerHull.opaque) addOverdrawPart(width, height, screen, part, item, overdrawOpaque, overdrawOpaqueItems);
+                for (const HullRect& part : layerHull.translucent) addOverdrawPart(width, height, screen, part, item, overdrawTranslucent, overdrawTranslucentItems);
+            }
+            item++;
+            c += command.count;
+            break;
+        }
+    }
+    rasterItems.clear();
+
+    // Nearest opaque item so far per pixel (-1: none), like the depth buffer with GL_LEQUAL
+    counts.assign((size_t)width * height, 0);
+    overdrawDepth.assign((size_t)width * height, -1);
+    for (size_t p = overdrawOpaque.size(); p-- > 0;) {
+        const RasterItem& piece = overdrawOpaque[p];
+        int depth = (int)overdrawOpaqueItems[p];
+        for (int y = piece.y0; y < piece.y1; y++) {
+            for (int x = piece.x0; x < piece.x1; x++) {
+                size_t pixel = (size_t)y * width + x;
+                if (overdrawDepth[pixel] > depth || !overdrawCovers(piece, x, y)) continue;
+                overdrawDepth[pixel] = depth;
+                counts[pixel]++;
+            }
+        }
+    }
+    for (size_t p = 0; p < overdrawTranslucent.size(); p++) {
+        const RasterItem& piece = overdrawTranslucent[p];
+        int depth = (int)overdrawTranslucentItems[p];
+        for (int y = piece.y0; y < piece.y1; y++) {
+            for (int x = piece.x0; x < piece.x1; x++) {
+                size_t pixel = (size_t)y * width + x;
+                if (overdrawDepth[pixel] > depth || !overdrawCovers(piece, x, y)) continue;
+                counts[pixel]++;
+            }
+        }
+    }
+    unsigned long long total = 0;
+    for (uint16_t count : counts) total += count;
+    return counts.empty() ? 0.0 : (double)total / counts.size();
+}
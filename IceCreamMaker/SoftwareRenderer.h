@@ -0,0 +1,59 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+// Pure-CPU backend for the same DrawList the GL renderer consumes. The target is split
+// into tiles that worker threads rasterize independently, each drawing its items in list
+// order, so the output is the same for any thread count and with or without SIMD.
+
+#include <vector>
+#include <cstdint>
+#include "DrawList.h"
+
+// RGBA8 pixels, one uint32 each with red in the lowest byte, bottom row first like GL
+struct SoftwareImage {
+    int width = 0, height = 0;
+    std::vector<uint32_t> pixels;
+};
+
+// Software twin of the Toppings.cpp layer
+struct SoftwareToppings {
+    SoftwareImage image;
+    unsigned int bakedResetCount = 0;
+    bool empty = true;
+};
+
+// Function declarations
+// threadCount 0 uses every hardware thread; the calling thread always works too
+void initSoftwareRenderer(int threadCount = 0);
+int getSoftwareThreadCount();
+// Switches between the SSE2 and scalar paths (both give identical pixels)
+void setSoftwareSimd(bool enabled);
+bool isSoftwareSimdAvailable();
+void destroySoftwareRenderer();
+
+void initSoftwareImage(SoftwareImage& image, int width, int height);
+// From tightly packed RGBA rows, bottom row first (packAtlas() output)
+void softwareImageFromRGBA(SoftwareImage& image, int width, int height, const std::vector<unsigned char>& rgba);
+void clearSoftwareImage(SoftwareImage& image, const float color[4]);
+// Tightly packed RGB rows, top row first, ready for writePPM()
+void readSoftwareImage(const SoftwareImage& image, std::vector<unsigned char>& rgb);
+
+void initSoftwareToppings(SoftwareToppings& toppings, int screenWidth, int screenHeight, const SprinkleSystem& sprinkles);
+// Renders sprinkles that settled since the last call into the layer, like bakeToppings()
+void bakeSoftwareToppings(SoftwareToppings& toppings, SprinkleSystem& sprinkles, float aspect);
+// Draws the list over target with SRC_ALPHA blending; sprites are sampled from atlas
+void renderSoftwareDrawList(SoftwareImage& target, const DrawList& list, const SoftwareImage& atlas,
+    const SoftwareToppings& toppings, float aspect);
+// Only commands [firstCommand, endCommand) of the list
+void renderSoftwareCommands(SoftwareImage& target, const DrawList& list, size_t firstCommand, size_t endCommand,
+    const SoftwareImage& atlas, const SoftwareToppings& toppings, float aspect);
+// Covers target with the whole of an opaque source image, filtered like GL_LINEAR
+void upscaleSoftwareImage(SoftwareImage& target, const SoftwareImage& source);
+// Fragments the GL renderer writes per pixel for the list, with its layers cached: in list order
+// with every sprite and layer blended whole (split off), or the opaque parts of the hulls front to
+// back with depth writes first and the rest only where no later opaque part covers it (split on).
+// counts gets the number for every pixel, bottom row first; returns their mean.
+double measureSoftwareOverdraw(int width, int height, const DrawList& list, const SoftwareToppings& toppings,
+    float aspect, bool split, std::vector<uint16_t>& counts);
+
+#endif
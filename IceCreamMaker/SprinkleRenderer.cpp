@@ -0,0 +1,60 @@
+#include "SprinkleRenderer.h"
+#include <GL/glew.h>
+#include <cstddef>
+
+static unsigned int instanceVBO = 0;
+static size_t instanceCapacity = 0;
+static std::vector<SprinkleInstance> instanceData;
+
+void initSprinklesRendering(const ShaderProgram& shader, unsigned int VAO, float aspect) {
+    bindVertexArray(VAO);
+    glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+    const GLsizei stride = sizeof(SprinkleInstance);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SprinkleInstance, x));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SprinkleInstance, size));
+    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SprinkleInstance, rotation));
+    glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SprinkleInstance, color));
+    for (int attribute = 2; attribute <= 5; attribute++) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+    bindVertexArray(0);
+
+    useProgram(shader);
+    glUniform1f(shader.uniforms[UNIFORM_ASPECT], aspect);
+    glUniform4f(shader.uniforms[UNIFORM_VIEW], 0.0f, 0.0f, 1.0f, 1.0f);
+}
+
+void drawSprinkles(const SprinkleSystem& sprinkles, const ShaderProgram& shader, unsigned int VAO, float alpha) {
+    if (sprinkles.store.empty()) return;
+
+    buildSprinkleInstances(sprinkles, alpha, instanceData);
+    drawSprinkleInstances(shader, VAO, instanceData.data(), instanceData.size());
+}
+
+void drawSprinkleInstances(const ShaderProgram& shader, unsigned int VAO, const SprinkleInstance* instances, size_t count,
+    float depth) {
+    if (count == 0) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (count > instanceCapacity) {
+        instanceCapacity = count;
+    }
+    // Orphan last frame's storage instead of waiting for it to be consumed
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(SprinkleInstance), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(SprinkleInstance), instances);
+
+    useProgram(shader);
+    glUniform1f(shader.uniforms[UNIFORM_DEPTH], depth);
+    bindVertexArray(VAO);
+    glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, (GLsizei)count);
+}
+
+void destroySprinklesRendering() {
+    glDeleteBuffers(1, &instanceVBO);
+    instanceVBO = 0;
+    instanceCapacity = 0;
+    instanceData.clear();
+}
@@ -0,0 +1,17 @@
+#ifndef SPRINKLE_RENDERER_H
+#define SPRINKLE_RENDERER_H
+
+#include "Sprinkles.h"
+#include "GLState.h"
+
+// Function declarations
+// Hooks the per-instance buffer into the particle VAO; call once after the VAO exists
+void initSprinklesRendering(const ShaderProgram& shader, unsigned int VAO, float aspect);
+// Draws every live sprinkle with one instanced call, alpha of the way from the last step's start to its end
+void drawSprinkles(const SprinkleSystem& sprinkles, const ShaderProgram& shader, unsigned int VAO, float alpha = 1.0f);
+// depth is the NDC z they are drawn at; it only matters while depth testing is on
+void drawSprinkleInstances(const ShaderProgram& shader, unsigned int VAO, const SprinkleInstance* instances, size_t count,
+    float depth = 0.0f);
+void destroySprinklesRendering();
+
+#endif
@@ -0,0 +1,126 @@
+#include "SprinkleStore.h"
+
+const uint32_t SprinkleStore::NO_SLOT;
+
+void SprinkleStore::init(size_t capacity) {
+    // Old slot indices may not fit the new arrays, and generations restart anyway
+    liveCount = 0;
+    x.assign(capacity, 0.0f);
+    y.assign(capacity, 0.0f);
+    prevX.assign(capacity, 0.0f);
+    prevY.assign(capacity, 0.0f);
+    vx.assign(capacity, 0.0f);
+    vy.assign(capacity, 0.0f);
+    size.assign(capacity, 0.0f);
+    rotation.assign(capacity, 0.0f);
+    prevRotation.assign(capacity, 0.0f);
+    rotationSpeed.assign(capacity, 0.0f);
+    state.assign(capacity, SPRINKLE_FALLING);
+    colorIndex.assign(capacity, 0);
+
+    denseSlot.assign(capacity, NO_SLOT);
+    slotDense.assign(capacity, 0);
+    slotGeneration.assign(capacity, 0);
+    olderSlot.assign(capacity, NO_SLOT);
+    newerSlot.assign(capacity, NO_SLOT);
+    freeSlots.reserve(capacity);
+    clear();
+}
+
+void SprinkleStore::clear() {
+    // Freeing every live slot invalidates all outstanding handles
+    for (size_t i = 0; i < liveCount; i++) {
+        slotGeneration[denseSlot[i]]++;
+    }
+    liveCount = 0;
+    oldestSlot = newestSlot = NO_SLOT;
+
+    // Hand slots out lowest first
+    freeSlots.clear();
+    for (size_t slot = capacity(); slot > 0; slot--) {
+        freeSlots.push_back((uint32_t)(slot - 1));
+    }
+}
+
+size_t SprinkleStore::add() {
+    if (capacity() == 0) init(1);
+    if (liveCount == capacity()) removeOldest();
+
+    uint32_t slot = freeSlots.back();
+    freeSlots.pop_back();
+
+    size_t index = liveCount++;
+    denseSlot[index] = slot;
+    slotDense[slot] = (uint32_t)index;
+
+    // Append to the newest end of the spawn-order list
+    olderSlot[slot] = newestSlot;
+    newerSlot[slot] = NO_SLOT;
+    if (newestSlot != NO_SLOT) newerSlot[newestSlot] = slot;
+    else oldestSlot = slot;
+    newestSlot = slot;
+
+    x[index] = y[index] = 0.0f;
+    prevX[index] = prevY[index] = 0.0f;
+    vx[index] = vy[index] = 0.0f;
+    size[index] = 0.0f;
+    rotation[index] = prevRotation[index] = rotationSpeed[index] = 0.0f;
+    state[index] = SPRINKLE_FALLING;
+    colorIndex[index] = 0;
+    return index;
+}
+
+void SprinkleStore::remove(size_t index) {
+    uint32_t slot = denseSlot[index];
+
+    // Unlink from the spawn-order list
+    if (olderSlot[slot] != NO_SLOT) newerSlot[olderSlot[slot]] = newerSlot[slot];
+    else oldestSlot = newerSlot[slot];
+    if (newerSlot[slot] != NO_SLOT) olderSlot[newerSlot[slot]] = olderSlot[slot];
+    else newestSlot = olderSlot[slot];
+
+    slotGeneration[slot]++;
+    freeSlots.push_back(slot);
+
+    size_t last = --liveCount;
+    if (index != last) moveTo(last, index);
+}
+
+void SprinkleStore::removeOldest() {
+    if (oldestSlot != NO_SLOT) remove(slotDense[oldestSlot]);
+}
+
+SprinkleHandle SprinkleStore::handleOf(size_t index) const {
+    SprinkleHandle handle;
+    handle.slot = denseSlot[index];
+    handle.generation = slotGeneration[handle.slot];
+    return handle;
+}
+
+bool SprinkleStore::isAlive(SprinkleHandle handle) const {
+    // The slot must be in use (a never-used slot still has generation 0) and not reused since
+    return handle.slot < capacity() && slotGeneration[handle.slot] == handle.generation &&
+        slotDense[handle.slot] < liveCount && denseSlot[slotDense[handle.slot]] == handle.slot;
+}
+
+size_t SprinkleStore::indexOf(SprinkleHandle handle) const {
+    return slotDense[handle.slot];
+}
+
+void SprinkleStore::moveTo(size_t from, size_t to) {
+    x[to] = x[from];
+    y[to] = y[from];
+    prevX[to] = prevX[from];
+    prevY[to] = prevY[from];
+    vx[to] = vx[from];
+    vy[to] = vy[from];
+    size[to] = size[from];
+    rotation[to] = rotation[from];
+    prevRotation[to] = prevRotation[from];
+    rotationSpeed[to] = rotationSpeed[from];
+    state[to] = state[from];
+    colorIndex[to] = colorIndex[from];
+
+    denseSlot[to] = denseSlot[from];
+    slotDense[denseSlot[to]] = (uint32_t)to;
+}
@@ -0,0 +1,73 @@
+#ifndef SPRINKLE_STORE_H
+#define SPRINKLE_STORE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Sprinkle life cycle, stored per sprinkle in SprinkleStore::state
+enum SprinkleState : uint8_t {
+    SPRINKLE_FALLING = 0,   // Falling from the nozzle towards the tunnel entrance
+    SPRINKLE_IN_TUNNEL = 1, // Sliding down the tunnel
+    SPRINKLE_DROPPING = 2,  // Falling from the tunnel exit onto the ice cream
+    SPRINKLE_SETTLED = 3    // Resting on the ice cream
+};
+
+// Stays valid while its sprinkle is alive, no matter how the dense arrays get reshuffled
+struct SprinkleHandle {
+    uint32_t slot = 0;
+    uint32_t generation = 0;
+};
+
+// Fixed-capacity sprinkle pool in structure-of-arrays form.
+// Live sprinkles are packed into [0, count()) of every array so the physics kernel can
+// stream them; removal swaps the last sprinkle into the hole. Each sprinkle also owns a
+// slot that links it into a spawn-order list, which gives O(1) oldest-first eviction
+// and stable handles. Nothing allocates after init().
+class SprinkleStore {
+public:
+    std::vector<float> x, y;
+    std::vector<float> prevX, prevY;    // Where the last fixed step started, for render interpolation
+    std::vector<float> vx, vy;
+    std::vector<float> size;
+    std::vector<float> rotation;
+    std::vector<float> prevRotation;
+    std::vector<float> rotationSpeed;
+    std::vector<uint8_t> state;         // SprinkleState
+    std::vector<uint8_t> colorIndex;    // Index into SPRINKLE_PALETTE
+
+    // Preallocates room for capacity sprinkles and empties the pool
+    void init(size_t capacity);
+    void clear();
+
+    size_t count() const { return liveCount; }
+    size_t capacity() const { return slotDense.size(); }
+    bool empty() const { return liveCount == 0; }
+
+    // Adds a zeroed sprinkle and returns its dense index; evicts the oldest one when full
+    size_t add();
+    // Swap-and-pop: the last sprinkle moves into index, so revisit index when iterating
+    void remove(size_t index);
+    void removeOldest();
+
+    SprinkleHandle handleOf(size_t index) const;
+    bool isAlive(SprinkleHandle handle) const;
+    size_t indexOf(SprinkleHandle handle) const; // Only valid for live handles
+
+private:
+    static const uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+    size_t liveCount = 0;
+    std::vector<uint32_t> denseSlot;      // Dense index -> slot
+    std::vector<uint32_t> slotDense;      // Slot -> dense index
+    std::vector<uint32_t> slotGeneration; // Bumped every time the slot is freed
+    std::vector<uint32_t> olderSlot;      // Spawn-order list, oldest at oldestSlot
+    std::vector<uint32_t> newerSlot;
+    std::vector<uint32_t> freeSlots;
+    uint32_t oldestSlot = NO_SLOT;
+    uint32_t newestSlot = NO_SLOT;
+
+    void moveTo(size_t from, size_t to);
+};
+
+#endif
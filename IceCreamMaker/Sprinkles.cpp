@@ -1,15 +1,11 @@
 #include "Sprinkles.h"
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
-#include <iostream>
 #include <algorithm>
 #include <cmath>
-#include <random>
-
-std::vector<Sprinkle> sprinkles;
-bool sprinklesOpen = false;
-std::random_device rd;
-std::mt19937 gen(rd());
+#include <cstddef>
+#include <cstring>
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
 
 // Constants
 const float GRAVITYS = -5.0f;
@@ -27,267 +23,354 @@ const float TUNNEL_END_X = 0.16f;
 const float TUNNEL_END_Y = -0.17f;       
 
 const float SLIDE_SPEED = 0.5f;
-const float EXIT_WAIT_TIME = 0.5f;
+const float SPRINKLE_SPAWN_INTERVAL = 0.08f;
+
+const size_t DEFAULT_SPRINKLE_CAPACITY = 300;
+
+const int SPRINKLE_PALETTE_SIZE = 7;
+const float SPRINKLE_PALETTE[][3] = {
+    { 0.09f, 0.09f, 0.639f },  // Blue
+    { 1.0f, 0.0f, 0.0f },      // Red
+    { 0.0f, 0.73f, 0.0f },     // Green
+    { 1.0f, 0.9f, 0.0f },      // Yellow
+    { 1.0f, 0.75f, 0.80f },    // Pink
+    { 0.30f, 0.192f, 0.078f }, // Chocolate
+    { 1.0f, 0.94f, 0.86f }     // Vanilla
+};
+
+const float TOPPINGS_LEFT = 0.1f;
+const float TOPPINGS_RIGHT = 0.6f;
+const float TOPPINGS_BOTTOM = -0.85f;
+const float TOPPINGS_TOP = -0.2f;
 
 const float TUNNEL_SLOPE = (TUNNEL_END_Y - TUNNEL_START_Y) / (TUNNEL_END_X - TUNNEL_START_X);
+const float TUNNEL_TRAVEL_TIME = (TUNNEL_END_X - TUNNEL_ENTRANCE_X) / SLIDE_SPEED;
+
+// Stream ids of the SprinkleSystem random streams
+enum SprinkleRandomStream {
+    RANDOM_SPAWN = 0,
+    RANDOM_TUNNEL_EXIT = 1,
+    RANDOM_LANDING = 2,
+    RANDOM_BENCHMARK = 3
+};
+
+void initSprinkles(SprinkleSystem& sprinkles, size_t capacity) {
+    sprinkles.store.init(capacity);
+    sprinkles.settled.clear();
+    sprinkles.settled.reserve(capacity);
+    sprinkles.tunnelQueue.clear();
+    sprinkles.lastTunnelExit = -1.0e9;
+    seedSprinkles(sprinkles, randomSeedFromDevice());
+}
 
-extern bool vanillaFilled;
-extern float vanillaLevel;
-extern bool chocolateFilled;
-extern float chocolateLevel;
-extern bool mixedFilled;
-extern float mixedLevel;
-extern float cupBottomY;
-
-void initSprinkles() {
-    sprinkles.clear();
+void seedSprinkles(SprinkleSystem& sprinkles, uint64_t seed) {
+    initRandomStream(sprinkles.spawnRandom, seed, RANDOM_SPAWN);
+    initRandomStream(sprinkles.exitRandom, seed, RANDOM_TUNNEL_EXIT);
+    initRandomStream(sprinkles.landingRandom, seed, RANDOM_LANDING);
+    initRandomStream(sprinkles.benchmarkRandom, seed, RANDOM_BENCHMARK);
 }
 
 float getTunnelY(float x) {
     return TUNNEL_START_Y + TUNNEL_SLOPE * (x - TUNNEL_START_X);
 }
 
-void spawnSprinkles() {
-    if (!sprinklesOpen) return;
-
-    Sprinkle sprinkle;
-
-    // Spawn from NOZZLE
-    sprinkle.x = SPRINKLE_NOZZLE_X;
-    sprinkle.y = SPRINKLE_NOZZLE_Y;
-    sprinkle.slideTimer = 0.0f;
-    sprinkle.isInTunnel = false;
-    sprinkle.waitingToExit = false;
-    sprinkle.waitTimer = 0.0f;
-    sprinkle.collisionState = 0;
-
-    // Random velocities - horizontal spread
-    std::uniform_real_distribution<> disX(-0.08f, 0.08f); // more spread out
-    std::uniform_real_distribution<> disY(-0.15f, -0.08f);
-    sprinkle.vx = disX(gen);
-    sprinkle.vy = disY(gen);
-
-    // Random size
-    std::uniform_real_distribution<> disSize(0.01f, 0.02f); 
-    sprinkle.size = disSize(gen);
-
-    // Random rotation
-    sprinkle.rotation = 0.0f;
-    std::uniform_real_distribution<> disRotSpeed(-1.0f, 1.0f);
-    sprinkle.rotationSpeed = disRotSpeed(gen);
-
-    // Random color
-    std::uniform_int_distribution<> disFlavor(0, 6);
-    int flavor = disFlavor(gen);
-
-    switch (flavor) {
-    case 0:  // Blue
-        sprinkle.color[0] = 0.09f;
-        sprinkle.color[1] = 0.09f;
-        sprinkle.color[2] = 0.639f;
-        break;
-    case 1:  // Red
-        sprinkle.color[0] = 1.0f;
-        sprinkle.color[1] = 0.0f;
-        sprinkle.color[2] = 0.0f;
-        break;
-    case 2:  // Green
-        sprinkle.color[0] = 0.0f;
-        sprinkle.color[1] = 0.73f;
-        sprinkle.color[2] = 0.0f;
-        break;
-    case 3:  // Yellow
-        sprinkle.color[0] = 1.0f;
-        sprinkle.color[1] = 0.9f;
-        sprinkle.color[2] = 0.0f;
-        break;
-    case 4:  // Pink
-        sprinkle.color[0] = 1.0f;
-        sprinkle.color[1] = 0.75f;
-        sprinkle.color[2] = 0.80f;
-        break;
-    case 5:  // Chocolate
-        sprinkle.color[0] = 0.30f;
-        sprinkle.color[1] = 0.192f;
-        sprinkle.color[2] = 0.078f;
-        break;
-    case 6:  // Vanilla
-        sprinkle.color[0] = 1.0f;
-        sprinkle.color[1] = 0.94f;
-        sprinkle.color[2] = 0.86f;
-        break;
-    }
+void spawnSprinkles(SprinkleSystem& sprinkles) {
+    if (!sprinkles.open) return;
+    spawnSprinklesBatch(sprinkles, 1);
+}
 
-    sprinkle.active = true;
-    sprinkles.push_back(sprinkle);
+// Makes room for count new sprinkles at the end of the dense arrays, evicting the oldest
+// ones first (down to limit live ones) so later evictions can't swap the new ones out of that range
+static size_t addSprinkleRange(SprinkleStore& s, size_t count, size_t limit) {
+    if (s.capacity() == 0) s.init(1);
+    while (s.count() > 0 && s.count() + count > limit) s.removeOldest();
 
-    // Limit sprinkles
-    if (sprinkles.size() > 300) {
-        sprinkles.erase(sprinkles.begin());
-    }
+    size_t begin = s.count();
+    for (size_t n = 0; n < count; n++) s.add();
+    return begin;
 }
 
-void updateSprinklesPhysics(double deltaTime) {
-    static bool exitOccupied = false;
+void spawnSprinklesBatch(SprinkleSystem& sprinkles, size_t count) {
+    SprinkleStore& s = sprinkles.store;
+    RandomStream& spawnRandom = sprinkles.spawnRandom;
+    size_t limit = s.capacity();
+    if (sprinkles.liveLimit > 0 && sprinkles.liveLimit < limit) limit = sprinkles.liveLimit;
+    // Past the limit the batch would only evict its own sprinkles
+    if (count > limit) count = limit > 0 ? limit : 1;
+    size_t begin = addSprinkleRange(s, count, limit);
+
+    // Spawn from NOZZLE; add() already zeroed rotation and set the falling state
+    std::fill_n(&s.x[begin], count, SPRINKLE_NOZZLE_X);
+    std::fill_n(&s.y[begin], count, SPRINKLE_NOZZLE_Y);
+    std::fill_n(&s.prevX[begin], count, SPRINKLE_NOZZLE_X);
+    std::fill_n(&s.prevY[begin], count, SPRINKLE_NOZZLE_Y);
+
+    // Random velocities - horizontal spread, size, rotation speed and color
+    fillRandomFloats(spawnRandom, &s.vx[begin], count, -0.08f, 0.08f);
+    fillRandomFloats(spawnRandom, &s.vy[begin], count, -0.15f, -0.08f);
+    fillRandomFloats(spawnRandom, &s.size[begin], count, 0.01f, 0.02f);
+    fillRandomFloats(spawnRandom, &s.rotationSpeed[begin], count, -1.0f, 1.0f);
+    fillRandomIndices(spawnRandom, &s.colorIndex[begin], count, SPRINKLE_PALETTE_SIZE);
+}
 
-    for (auto& drop : sprinkles) {
-        if (!drop.active) continue;
+// Integration for every sprinkle at once, written so it has no per-sprinkle branches:
+//   states 1-3 first move by their current velocity,
+//   falling states (0 and 2) then get gravity, another position step and rotation.
+// That reproduces the old per-state order exactly (state 0: gravity then move,
+// state 2: move, gravity, move again). vx doesn't change in between, so both x steps are
+// taken as one, and every path rounds it the same way: the tail of the SIMD loops goes
+// through here, so a sprinkle must not move differently there than in a vector lane.
+static void integrateSprinklesScalar(SprinkleStore& s, size_t begin, size_t end, float dt) {
+    for (size_t i = begin; i < end; i++) {
+        float moving = s.state[i] != SPRINKLE_FALLING ? 1.0f : 0.0f;
+        float falling = (s.state[i] & 1) == 0 ? 1.0f : 0.0f;
+
+        s.x[i] += s.vx[i] * dt * (moving + falling);
+        s.y[i] += s.vy[i] * dt * moving;
+        s.vy[i] += GRAVITYS * dt * falling;
+        s.y[i] += s.vy[i] * dt * falling;
+        s.rotation[i] += s.rotationSpeed[i] * dt * falling;
+    }
+}
 
-        // Store previous position
-        float prevX = drop.x - drop.vx * deltaTime;
-        float prevY = drop.y - drop.vy * deltaTime;
+#if defined(__AVX2__)
+void integrateSprinkles(SprinkleStore& s, float dt) {
+    const size_t count = s.count();
+    const size_t wideCount = count & ~(size_t)7;
+
+    const __m256 dtV = _mm256_set1_ps(dt);
+    const __m256 gravityDt = _mm256_set1_ps(GRAVITYS * dt);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lowBit = _mm256_set1_epi32(1);
+
+    for (size_t i = 0; i < wideCount; i += 8) {
+        __m256i state = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&s.state[i]));
+        __m256 moving = _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(state, zero)), one);
+        __m256 falling = _mm256_and_ps(
+            _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(state, lowBit), zero)), one);
+
+        __m256 x = _mm256_loadu_ps(&s.x[i]);
+        __m256 y = _mm256_loadu_ps(&s.y[i]);
+        __m256 vx = _mm256_loadu_ps(&s.vx[i]);
+        __m256 vy = _mm256_loadu_ps(&s.vy[i]);
+        __m256 rotation = _mm256_loadu_ps(&s.rotation[i]);
+        __m256 rotationSpeed = _mm256_loadu_ps(&s.rotationSpeed[i]);
+
+        __m256 vxDt = _mm256_mul_ps(vx, dtV);
+        x = _mm256_add_ps(x, _mm256_mul_ps(vxDt, _mm256_add_ps(moving, falling)));
+        y = _mm256_add_ps(y, _mm256_mul_ps(_mm256_mul_ps(vy, dtV), moving));
+        vy = _mm256_add_ps(vy, _mm256_mul_ps(gravityDt, falling));
+        y = _mm256_add_ps(y, _mm256_mul_ps(_mm256_mul_ps(vy, dtV), falling));
+        rotation = _mm256_add_ps(rotation, _mm256_mul_ps(_mm256_mul_ps(rotationSpeed, dtV), falling));
+
+        _mm256_storeu_ps(&s.x[i], x);
+        _mm256_storeu_ps(&s.y[i], y);
+        _mm256_storeu_ps(&s.vy[i], vy);
+        _mm256_storeu_ps(&s.rotation[i], rotation);
+    }
+    integrateSprinklesScalar(s, wideCount, count, dt);
+}
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+void integrateSprinkles(SprinkleStore& s, float dt) {
+    const size_t count = s.count();
+    const size_t wideCount = count & ~(size_t)3;
+
+    const __m128 dtV = _mm_set1_ps(dt);
+    const __m128 gravityDt = _mm_set1_ps(GRAVITYS * dt);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowBit = _mm_set1_epi32(1);
+
+    for (size_t i = 0; i < wideCount; i += 4) {
+        int packedState;
+        memcpy(&packedState, &s.state[i], sizeof(packedState));
+        __m128i state = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packedState), zero), zero);
+        __m128 moving = _mm_andnot_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(state, zero)), one);
+        __m128 falling = _mm_and_ps(
+            _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(state, lowBit), zero)), one);
+
+        __m128 x = _mm_loadu_ps(&s.x[i]);
+        __m128 y = _mm_loadu_ps(&s.y[i]);
+        __m128 vx = _mm_loadu_ps(&s.vx[i]);
+        __m128 vy = _mm_loadu_ps(&s.vy[i]);
+        __m128 rotation = _mm_loadu_ps(&s.rotation[i]);
+        __m128 rotationSpeed = _mm_loadu_ps(&s.rotationSpeed[i]);
+
+        __m128 vxDt = _mm_mul_ps(vx, dtV);
+        x = _mm_add_ps(x, _mm_mul_ps(vxDt, _mm_add_ps(moving, falling)));
+        y = _mm_add_ps(y, _mm_mul_ps(_mm_mul_ps(vy, dtV), moving));
+        vy = _mm_add_ps(vy, _mm_mul_ps(gravityDt, falling));
+        y = _mm_add_ps(y, _mm_mul_ps(_mm_mul_ps(vy, dtV), falling));
+        rotation = _mm_add_ps(rotation, _mm_mul_ps(_mm_mul_ps(rotationSpeed, dtV), falling));
+
+        _mm_storeu_ps(&s.x[i], x);
+        _mm_storeu_ps(&s.y[i], y);
+        _mm_storeu_ps(&s.vy[i], vy);
+        _mm_storeu_ps(&s.rotation[i], rotation);
+    }
+    integrateSprinklesScalar(s, wideCount, count, dt);
+}
+#else
+void integrateSprinkles(SprinkleStore& s, float dt) {
+    integrateSprinklesScalar(s, 0, s.count(), dt);
+}
+#endif
 
-        // Apply gravity only if not in tunnel or settled
-        if (drop.collisionState == 0) { // Only when falling from nozzle
-            drop.vy += GRAVITYS * deltaTime;
-        }
+// Height of the highest ice cream layer under x, or the floor outside the cup
+static float getSurfaceHeight(const IceCreamState& iceCream, float x) {
+    float highestIceCream = FINAL_GROUND_Y;
 
-        // Update position
-        drop.x += drop.vx * deltaTime;
-        drop.y += drop.vy * deltaTime;
+    // Check if sprinkle is over the cup area
+    if (x > 0.18f && x < 0.5f) {
+        const float TEXTURE_SCALE = 0.3f;
 
-        // Update rotation (only when falling)
-        if (drop.collisionState == 0) {
-            drop.rotation += drop.rotationSpeed * deltaTime;
+        if (iceCream.vanillaFill.isFilled) {
+            float scaledVanillaHeight = -0.54f + (iceCream.vanillaFill.fillLevel + 0.54f) * TEXTURE_SCALE;
+            if (scaledVanillaHeight > highestIceCream) {
+                highestIceCream = scaledVanillaHeight;
+            }
         }
 
-        // State machine for sprinkles
-        switch (drop.collisionState) {
-        case 0: // Falling from nozzle to tunnel entrance
-            // Check if sprinkle hits the tunnel entrance
-            if (prevY > TUNNEL_ENTRANCE_Y && drop.y <= TUNNEL_ENTRANCE_Y + drop.size &&
-                drop.x >= TUNNEL_ENTRANCE_X - 0.05f && drop.x <= TUNNEL_ENTRANCE_X + 0.05f) {
-
-                // Place sprinkle at tunnel entrance
-                drop.x = TUNNEL_ENTRANCE_X;
-                drop.y = TUNNEL_ENTRANCE_Y + drop.size;
-                drop.vx = 0.0f;
-                drop.vy = 0.0f;
-                drop.collisionState = 1; // Now in tunnel
-                drop.isInTunnel = true;
-                drop.slideTimer = 0.0f;
-
-                // Only proceed if exit is not occupied
-                if (!exitOccupied) {
-                    drop.waitingToExit = false;
-                }
-                else {
-                    drop.waitingToExit = true;
-                    drop.waitTimer = 0.0f;
-                }
-            }
-            // If sprinkle misses tunnel and falls too low, deactivate it
-            else if (drop.y < -1.0f) {
-                drop.active = false;
+        if (iceCream.chocolateFill.isFilled) {
+            float scaledChocolateHeight = -0.54f + (iceCream.chocolateFill.fillLevel + 0.54f) * TEXTURE_SCALE;
+            if (scaledChocolateHeight > highestIceCream) {
+                highestIceCream = scaledChocolateHeight;
             }
-            break;
-
-        case 1: // Sliding in tunnel (vertical drop before slope)
-            drop.slideTimer += deltaTime;
-
-            // First, drop vertically a bit before starting slope
-            if (drop.y > TUNNEL_START_Y + drop.size) {
-                // Still falling vertically to reach slope start
-                drop.y -= 0.5f * deltaTime; // Controlled vertical drop
+        }
 
-                // Check if reached slope start
-                if (drop.y <= TUNNEL_START_Y + drop.size) {
-                    drop.y = TUNNEL_START_Y + drop.size;
-                }
+        if (iceCream.mixedFill.isFilled) {
+            float scaledMixedHeight = -0.54f + (iceCream.mixedFill.fillLevel + 0.54f) * TEXTURE_SCALE;
+            if (scaledMixedHeight > highestIceCream) {
+                highestIceCream = scaledMixedHeight;
             }
-            else {
-                // Now on the slope, handle waiting/exit logic
-                if (drop.waitingToExit) {
-                    // Wait at current position
-                    drop.waitTimer += deltaTime;
-
-                    // Check if exit is now free
-                    if (!exitOccupied && drop.waitTimer > 0.1f) {
-                        drop.waitingToExit = false;
-                        exitOccupied = true;
-                    }
-                }
-                else {
-                    // Move along tunnel slope towards exit
-                    if (drop.x < TUNNEL_END_X) {
-                        drop.x += SLIDE_SPEED * deltaTime;
-                        drop.y = getTunnelY(drop.x) + drop.size;
-
-                        // Check if reached exit
-                        if (drop.x >= TUNNEL_END_X) {
-                            drop.x = TUNNEL_END_X;
-                            drop.y = TUNNEL_END_Y + drop.size;
-
-                            // Wait a bit at exit, then fall to ice cream
-                            drop.waitTimer += deltaTime;
-                            if (drop.waitTimer > EXIT_WAIT_TIME) {
-                                drop.collisionState = 2; // Falling from exit
-                                drop.isInTunnel = false;
-                                exitOccupied = false;
-                            }
-                        }
-                    }
-                }
-            }
-            if (drop.x >= TUNNEL_END_X - 0.01f && drop.collisionState == 1) {
-                drop.collisionState = 2;
-                drop.isInTunnel = false;
+        }
+    }
+    return highestIceCream;
+}
 
-                //random velocities to spread sprinkles across cup
-                std::uniform_real_distribution<> disExitVX(-0.05f, 0.25f); 
-                std::uniform_real_distribution<> disExitVY(-0.02f, 0.1f);
+// Slide position of a queued sprinkle at time; ones held back by the exit spacing wait at the exit
+static void getTunnelPosition(const TunnelEntry& entry, double time, float size, float& x, float& y) {
+    float travelled = (float)std::max(time - entry.entryTime, 0.0) * SLIDE_SPEED;
+    x = std::min(TUNNEL_ENTRANCE_X + travelled, TUNNEL_END_X);
+    y = getTunnelY(x) + size;
+}
 
-                drop.vx = disExitVX(gen);
-                drop.vy = disExitVY(gen);
-            }
-            break;
+// Releases every sprinkle whose exit time has come; the rest of the queue is not looked at.
+// A sprinkle leaves at the end of its slide, but never sooner than tunnelExitInterval after the
+// one ahead of it actually left.
+static void releaseTunnelExits(SprinkleSystem& sprinkles) {
+    SprinkleStore& s = sprinkles.store;
+    std::deque<TunnelEntry>& tunnelQueue = sprinkles.tunnelQueue;
+
+    while (!tunnelQueue.empty()) {
+        TunnelEntry entry = tunnelQueue.front();
+        // The pool may have evicted it while it was queued; it gives up its turn
+        if (!s.isAlive(entry.handle)) {
+            tunnelQueue.pop_front();
+            continue;
+        }
+        double slideEnd = entry.entryTime + TUNNEL_TRAVEL_TIME;
+        double exitTime = std::max(slideEnd, sprinkles.lastTunnelExit + sprinkles.tunnelExitInterval);
+        if (exitTime > sprinkles.tunnelClock) break;
+        tunnelQueue.pop_front();
+        sprinkles.lastTunnelExit = exitTime;
+        size_t i = s.indexOf(entry.handle);
+
+        s.x[i] = s.prevX[i] = TUNNEL_END_X;
+        s.y[i] = s.prevY[i] = TUNNEL_END_Y + s.size[i];
+        s.state[i] = SPRINKLE_DROPPING;
+
+        //random velocities to spread sprinkles across cup
+        s.vx[i] = randomFloat(sprinkles.exitRandom, -0.05f, 0.25f);
+        s.vy[i] = randomFloat(sprinkles.exitRandom, -0.02f, 0.1f);
+
+        sprinkles.tunnelStats.exits++;
+        // Measured from slideEnd itself, so a sprinkle that didn't queue adds exactly 0 rather than rounding noise
+        sprinkles.tunnelStats.totalWaitTime += std::max(0.0, exitTime - slideEnd);
+    }
+}
 
-        case 2: // Falling from tunnel exit to ice cream
-        {
-            // Apply gravity
-            drop.vy += GRAVITYS * deltaTime;
-            drop.rotation += drop.rotationSpeed * deltaTime;
+// Spawns whatever the nozzle produced during this step
+static void updateSprinkleSpawner(SprinkleSystem& sprinkles, float dt) {
+    float interval = sprinkles.spawnInterval > 0.0f ? sprinkles.spawnInterval : SPRINKLE_SPAWN_INTERVAL;
+    if (!sprinkles.open) {
+        // Opening the lever drops the first sprinkle right away
+        sprinkles.timeSinceSpawn = interval;
+        return;
+    }
 
-            // Update position
-            drop.x += drop.vx * deltaTime;
-            drop.y += drop.vy * deltaTime;
+    sprinkles.timeSinceSpawn += dt;
+    size_t due = 0;
+    while (sprinkles.timeSinceSpawn >= interval) {
+        sprinkles.timeSinceSpawn -= interval;
+        due++;
+    }
+    if (due > 0) spawnSprinklesBatch(sprinkles, due);
+}
 
-            // Calculate surface height at this position
-            float surfaceHeight = FINAL_GROUND_Y; // Default to floor
-            float highestIceCream = FINAL_GROUND_Y;
+void updateSprinklesPhysics(SprinkleSystem& sprinkles, const IceCreamState& iceCream, double deltaTime) {
+    SprinkleStore& s = sprinkles.store;
+    const float dt = (float)deltaTime;
+    sprinkles.tunnelClock += deltaTime;
+    sprinkles.lastStepTime = deltaTime;
 
-            // Check if sprinkle is over the cup area
-            if (drop.x > 0.18f && drop.x < 0.5f) {
+    // Remember where this step starts so drawing can blend towards the result
+    std::copy(s.x.begin(), s.x.begin() + s.count(), s.prevX.begin());
+    std::copy(s.y.begin(), s.y.begin() + s.count(), s.prevY.begin());
+    std::copy(s.rotation.begin(), s.rotation.begin() + s.count(), s.prevRotation.begin());
 
-                const float TEXTURE_SCALE = 0.3f;
+    // Gravity, position and rotation for everyone, SIMD where available.
+    // Tunnel sprinkles have zero velocity and no gravity, so it leaves them alone.
+    integrateSprinkles(s, dt);
+    releaseTunnelExits(sprinkles);
 
-                if (vanillaFilled) {
-                    float scaledVanillaHeight = -0.54f + (vanillaLevel + 0.54f) * TEXTURE_SCALE;
-                    if (scaledVanillaHeight > highestIceCream) {
-                        highestIceCream = scaledVanillaHeight;
-                    }
-                }
+    // State transitions; only the few sprinkles near a boundary do real work here
+    for (size_t i = 0; i < s.count();) {
+        bool active = true;
 
-                if (chocolateFilled) {
-                    float scaledChocolateHeight = -0.54f + (chocolateLevel + 0.54f) * TEXTURE_SCALE;
-                    if (scaledChocolateHeight > highestIceCream) {
-                        highestIceCream = scaledChocolateHeight;
-                    }
-                }
+        switch (s.state[i]) {
+        case SPRINKLE_FALLING: // Falling from nozzle to tunnel entrance
+        {
+            float prevY = s.y[i] - s.vy[i] * dt;
 
-                if (mixedFilled) {
-                    float scaledMixedHeight = -0.54f + (mixedLevel + 0.54f) * TEXTURE_SCALE;
-                    if (scaledMixedHeight > highestIceCream) {
-                        highestIceCream = scaledMixedHeight;
-                    }
-                }
+            // Check if sprinkle hits the tunnel entrance
+            if (prevY > TUNNEL_ENTRANCE_Y && s.y[i] <= TUNNEL_ENTRANCE_Y + s.size[i] &&
+                s.x[i] >= TUNNEL_ENTRANCE_X - 0.05f && s.x[i] <= TUNNEL_ENTRANCE_X + 0.05f) {
 
-                surfaceHeight = highestIceCream;
+                // Place sprinkle at tunnel entrance
+                s.x[i] = s.prevX[i] = TUNNEL_ENTRANCE_X;
+                s.y[i] = s.prevY[i] = TUNNEL_ENTRANCE_Y + s.size[i];
+                s.vx[i] = 0.0f;
+                s.vy[i] = 0.0f;
+                s.state[i] = SPRINKLE_IN_TUNNEL;
+
+                // releaseTunnelExits() lets it out once the slide and the ones ahead are done
+                TunnelEntry entry;
+                entry.handle = s.handleOf(i);
+                entry.entryTime = sprinkles.tunnelClock;
+                sprinkles.tunnelQueue.push_back(entry);
+                sprinkles.tunnelStats.maxQueueDepth =
+                    std::max(sprinkles.tunnelStats.maxQueueDepth, sprinkles.tunnelQueue.size());
+            }
+            // If sprinkle misses tunnel and falls too low, deactivate it
+            else if (s.y[i] < -1.0f) {
+                active = false;
             }
+            break;
+        }
+
+        case SPRINKLE_IN_TUNNEL: // Sliding in tunnel, released by releaseTunnelExits()
+            break;
+
+        case SPRINKLE_DROPPING: // Falling from tunnel exit to ice cream
+        {
+            // Calculate surface height at this position
+            float surfaceHeight = getSurfaceHeight(iceCream, s.x[i]);
 
             // Check for collision with surface (ice cream or floor)
-            if (drop.y - drop.size <= surfaceHeight) {
-                bool isInCup = (drop.x > 0.18f && drop.x < 0.5f);
+            if (s.y[i] - s.size[i] <= surfaceHeight) {
+                bool isInCup = (s.x[i] > 0.18f && s.x[i] < 0.5f);
                 if (isInCup && surfaceHeight > FINAL_GROUND_Y + 0.01f) {
 
                     float iceCreamTop = surfaceHeight;
@@ -296,76 +379,151 @@ void updateSprinklesPhysics(double deltaTime) {
 
                     // Most sprinkles land near top, some sink deeper
                     // Use exponential distribution for more realistic placement
-                    static std::uniform_real_distribution<> dist(0.0f, 1.0f);
-                    float randomFactor = dist(gen);
+                    float randomFactor = randomFloat(sprinkles.landingRandom, 0.0f, 1.0f);
 
                     // Square it to bias toward top (0.0-1.0 squared = more values near 0)
                     float depthFactor = randomFactor * randomFactor;
 
                     // Position: top - (depthFactor * thickness)
                     float sprinkleDepth = depthFactor * iceCreamThickness * 0.4f; // Max 70% deep
-                    drop.y = iceCreamTop - sprinkleDepth + drop.size;
+                    s.y[i] = iceCreamTop - sprinkleDepth + s.size[i];
 
-                    drop.vy = 0.0f;
-                    drop.vx *= 0.4f;
-                    drop.rotationSpeed *= 0.5f;
-                    drop.collisionState = 3;
+                    s.vy[i] = 0.0f;
+                    s.vx[i] *= 0.4f;
+                    s.rotationSpeed[i] *= 0.5f;
+                    s.state[i] = SPRINKLE_SETTLED;
                 }
             }
         }
         break;
 
-        case 3: // On surface (settled)
-            drop.vx *= FRICTION; // Apply friction
-            drop.rotationSpeed *= FRICTION;
+        case SPRINKLE_SETTLED: // On surface (settled)
+            s.vx[i] *= FRICTION; // Apply friction
+            s.rotationSpeed[i] *= FRICTION;
 
             // Stop completely if velocities are very small
-            if (fabs(drop.vx) < 0.01f) drop.vx = 0.0f;
-            if (fabs(drop.rotationSpeed) < 0.01f) drop.rotationSpeed = 0.0f;
+            if (fabs(s.vx[i]) < 0.01f) s.vx[i] = 0.0f;
+            if (fabs(s.rotationSpeed[i]) < 0.01f) s.rotationSpeed[i] = 0.0f;
+
+            // Once it stops moving it never changes again, so hand it to the toppings layer
+            if (sprinkles.bakingEnabled && s.vx[i] == 0.0f && s.rotationSpeed[i] == 0.0f &&
+                s.x[i] - s.size[i] > TOPPINGS_LEFT && s.x[i] + s.size[i] < TOPPINGS_RIGHT &&
+                s.y[i] - s.size[i] > TOPPINGS_BOTTOM && s.y[i] + s.size[i] < TOPPINGS_TOP) {
+                SettledSprinkle settled;
+                settled.x = s.x[i];
+                settled.y = s.y[i];
+                settled.size = s.size[i];
+                settled.rotation = s.rotation[i];
+                settled.colorIndex = s.colorIndex[i];
+                sprinkles.settled.push_back(settled);
+                active = false;
+            }
             break;
         }
 
         // Side boundaries only for falling sprinkles (state 0 or 2)
-        if (drop.collisionState == 0 || drop.collisionState == 2) {
-            if (drop.x - drop.size < -1.0f) {
-                drop.x = -1.0f + drop.size;
-                drop.vx = -drop.vx * DAMPING;
+        if (s.state[i] == SPRINKLE_FALLING || s.state[i] == SPRINKLE_DROPPING) {
+            if (s.x[i] - s.size[i] < -1.0f) {
+                s.x[i] = -1.0f + s.size[i];
+                s.vx[i] = -s.vx[i] * DAMPING;
             }
-            if (drop.x + drop.size > 1.0f) {
-                drop.x = 1.0f - drop.size;
-                drop.vx = -drop.vx * DAMPING;
+            if (s.x[i] + s.size[i] > 1.0f) {
+                s.x[i] = 1.0f - s.size[i];
+                s.vx[i] = -s.vx[i] * DAMPING;
             }
         }
 
         // Deactivate if below screen
-        if (drop.y < -2.0f) {
-            drop.active = false;
+        if (s.y[i] < -2.0f) {
+            active = false;
         }
+
+        // Retire inactive sprinkles; the last one is swapped into i, so look at i again
+        if (active) i++;
+        else s.remove(i);
     }
 
-    // Clean up inactive sprinkles
-    sprinkles.erase(
-        std::remove_if(sprinkles.begin(), sprinkles.end(),
-            [](const Sprinkle& d) { return !d.active; }),
-        sprinkles.end()
-    );
+    updateSprinkleSpawner(sprinkles, dt);
+}
+
+bool sprinklesMoving(const SprinkleSystem& sprinkles) {
+    // Tunnel sprinkles are placed from the clock, not the store, so they move while queued
+    if (sprinkles.open || !sprinkles.settled.empty() || !sprinkles.tunnelQueue.empty()) return true;
+    const SprinkleStore& s = sprinkles.store;
+    for (size_t i = 0; i < s.count(); i++) {
+        if (s.x[i] != s.prevX[i] || s.y[i] != s.prevY[i] || s.rotation[i] != s.prevRotation[i]) return true;
+    }
+    return false;
 }
 
-void drawSprinkles(const Sprinkle& drop, unsigned int shader, unsigned int VAO) {
-    glUseProgram(shader);
+void buildSprinkleInstances(const SprinkleSystem& sprinkles, float alpha, std::vector<SprinkleInstance>& instances) {
+    const SprinkleStore& s = sprinkles.store;
+
+    instances.resize(s.count());
+    for (size_t i = 0; i < s.count(); i++) {
+        SprinkleInstance& instance = instances[i];
+        const float* color = SPRINKLE_PALETTE[s.colorIndex[i]];
+        instance.x = s.prevX[i] + (s.x[i] - s.prevX[i]) * alpha;
+        instance.y = s.prevY[i] + (s.y[i] - s.prevY[i]) * alpha;
+        instance.size = s.size[i];
+        instance.rotation = s.prevRotation[i] + (s.rotation[i] - s.prevRotation[i]) * alpha;
+        instance.color[0] = color[0];
+        instance.color[1] = color[1];
+        instance.color[2] = color[2];
+    }
+
+    // Tunnel sprinkles only store where they entered; place them along the slope now
+    double renderTime = sprinkles.tunnelClock - (1.0 - alpha) * sprinkles.lastStepTime;
+    for (size_t n = 0; n < sprinkles.tunnelQueue.size(); n++) {
+        const TunnelEntry& entry = sprinkles.tunnelQueue[n];
+        if (!s.isAlive(entry.handle)) continue;
+        size_t i = s.indexOf(entry.handle);
+        getTunnelPosition(entry, renderTime, s.size[i], instances[i].x, instances[i].y);
+    }
+}
 
-    // Set uniforms
-    GLint posLoc = glGetUniformLocation(shader, "uPosition");
-    GLint sizeLoc = glGetUniformLocation(shader, "uSize");
-    GLint colorLoc = glGetUniformLocation(shader, "uColor");
+void buildSettledInstances(const SprinkleSystem& sprinkles, std::vector<SprinkleInstance>& instances) {
+    instances.resize(sprinkles.settled.size());
+    for (size_t i = 0; i < sprinkles.settled.size(); i++) {
+        const SettledSprinkle& settled = sprinkles.settled[i];
+        const float* color = SPRINKLE_PALETTE[settled.colorIndex];
+        SprinkleInstance& instance = instances[i];
+        instance.x = settled.x;
+        instance.y = settled.y;
+        instance.size = settled.size;
+        instance.rotation = settled.rotation;
+        instance.color[0] = color[0];
+        instance.color[1] = color[1];
+        instance.color[2] = color[2];
+    }
+}
 
-    if (posLoc != -1) glUniform2f(posLoc, drop.x, drop.y);
-    if (sizeLoc != -1) glUniform1f(sizeLoc, drop.size);
-    if (colorLoc != -1) glUniform3f(colorLoc, drop.color[0], drop.color[1], drop.color[2]);
+void spawnBenchmarkSprinkles(SprinkleSystem& sprinkles, size_t count) {
+    SprinkleStore& s = sprinkles.store;
+    RandomStream& benchmarkRandom = sprinkles.benchmarkRandom;
+    if (s.capacity() < count) s.init(count);
+    size_t begin = addSprinkleRange(s, count, s.capacity());
+
+    fillRandomFloats(benchmarkRandom, &s.x[begin], count, -0.95f, 0.95f);
+    fillRandomFloats(benchmarkRandom, &s.y[begin], count, -0.95f, 0.95f);
+    fillRandomFloats(benchmarkRandom, &s.size[begin], count, 0.01f, 0.02f);
+    std::copy(&s.x[begin], &s.x[begin] + count, &s.prevX[begin]);
+    std::copy(&s.y[begin], &s.y[begin] + count, &s.prevY[begin]);
+    fillRandomIndices(benchmarkRandom, &s.colorIndex[begin], count, SPRINKLE_PALETTE_SIZE);
+    // Resting, so they stay on screen for the whole run
+    std::fill_n(&s.state[begin], count, (uint8_t)SPRINKLE_SETTLED);
+}
 
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+void resetSprinkles(SprinkleSystem& sprinkles) {
+    sprinkles.store.clear();
+    sprinkles.tunnelQueue.clear();
+    sprinkles.lastTunnelExit = -1.0e9;
+    sprinkles.settled.clear();
+    sprinkles.resetCount++;
 }
-void resetSprinkles() {
-    sprinkles.clear();
+
+TunnelStats getTunnelStats(const SprinkleSystem& sprinkles) {
+    TunnelStats stats = sprinkles.tunnelStats;
+    stats.queueDepth = sprinkles.tunnelQueue.size();
+    return stats;
 }
\ No newline at end of file
@@ -2,36 +2,69 @@
 #define SPRINKLES_H
 
 #include <vector>
-#include <random>
+#include <deque>
+#include "SprinkleStore.h"
+#include "Random.h"
+#include "IceCream.h"
 
-struct Sprinkle {
+// A sprinkle that came to rest and leaves the simulation for the toppings layer
+struct SettledSprinkle {
     float x, y;
-    float vx, vy;
     float size;
     float rotation;
-    float rotationSpeed;
-    bool active;
-    float color[7];
-    float slideTimer;
-    bool isInTunnel;
-    bool waitingToExit;
-    float waitTimer;
-    int collisionState;
+    uint8_t colorIndex;
 };
 
-// Declare extern for global variables
-extern std::vector<Sprinkle> sprinkles;
-extern bool sprinklesOpen;
-extern std::mt19937 gen;
+// Throughput counters for the tunnel queue
+struct TunnelStats {
+    unsigned long long exits;  // Sprinkles that left the tunnel since startup
+    size_t queueDepth;         // Sprinkles in the tunnel right now
+    size_t maxQueueDepth;
+    double totalWaitTime;      // Time spent queued beyond the slide itself, summed over exits
+};
+
+// The tunnel is a FIFO: sprinkles leave in the order they came in, so only the front entry is
+// ever looked at. Its exit time is worked out when it gets there, so a sprinkle the pool evicted
+// on the way doesn't hold up the ones behind it.
+struct TunnelEntry {
+    SprinkleHandle handle;
+    double entryTime;
+};
 
-// Ice cream data (for sprinkles to fall on)
-extern bool vanillaFilled;
-extern float vanillaLevel;
-extern bool chocolateFilled;
-extern float chocolateLevel;
-extern bool mixedFilled;
-extern float mixedLevel;
-extern float cupBottomY;
+// Per-instance data streamed to particle.vert
+struct SprinkleInstance {
+    float x, y;
+    float size;
+    float rotation;
+    float color[3];
+};
+
+// Everything the sprinkle simulation keeps between steps
+struct SprinkleSystem {
+    SprinkleStore store;
+    bool open = false;                      // Sprinkle lever; the nozzle spawns while it is open
+    std::vector<SettledSprinkle> settled;   // Waiting to be baked; the renderer empties it
+    unsigned int resetCount = 0;            // Bumped by resetSprinkles() so baked toppings get wiped
+    bool bakingEnabled = true;
+    // Minimum time between two tunnel exits. The default is below SPRINKLE_SPAWN_INTERVAL, so
+    // nothing queues and sprinkles leave as soon as their slide ends, like they always have.
+    float tunnelExitInterval = 0.05f;
+
+    std::deque<TunnelEntry> tunnelQueue;
+    double tunnelClock = 0.0;               // Simulation time, advanced by updateSprinklesPhysics()
+    double lastStepTime = 0.0;              // Length of the last update, to interpolate tunnel positions
+    double lastTunnelExit = -1.0e9;         // When the last sprinkle that really left did
+    float timeSinceSpawn = 0.0f;
+    float spawnInterval = 0.0f;             // Between two sprinkles from the open nozzle; 0 = SPRINKLE_SPAWN_INTERVAL
+    size_t liveLimit = 0;                   // Spawns evict the oldest past this many; 0 = the store's capacity
+    TunnelStats tunnelStats = {};
+
+    // One stream per use, so e.g. the number of tunnel exits never shifts what gets spawned
+    RandomStream spawnRandom;
+    RandomStream exitRandom;
+    RandomStream landingRandom;
+    RandomStream benchmarkRandom;
+};
 
 // Constants - UPDATED
 extern const float GRAVITYS;
@@ -47,15 +80,40 @@ extern const float TUNNEL_START_Y;
 extern const float TUNNEL_END_X;
 extern const float TUNNEL_END_Y;
 extern const float SLIDE_SPEED;
-extern const float EXIT_WAIT_TIME;
+extern const float SPRINKLE_SPAWN_INTERVAL;
+extern const size_t DEFAULT_SPRINKLE_CAPACITY;
+extern const int SPRINKLE_PALETTE_SIZE;
+extern const float SPRINKLE_PALETTE[][3];
+// Area around the cup covered by the baked toppings layer
+extern const float TOPPINGS_LEFT;
+extern const float TOPPINGS_RIGHT;
+extern const float TOPPINGS_BOTTOM;
+extern const float TOPPINGS_TOP;
 
 // Function declarations
-void initSprinkles();
-void spawnSprinkles();
-void updateSprinklesPhysics(double deltaTime);
-void drawSprinkles(const Sprinkle& drop, unsigned int shader, unsigned int VAO);
-void resetSprinkles();
+// Preallocates the pool; once full, every spawn evicts the oldest sprinkle
+void initSprinkles(SprinkleSystem& sprinkles, size_t capacity = DEFAULT_SPRINKLE_CAPACITY);
+// Restarts every sprinkle random stream from seed; initSprinkles() seeds from the device
+void seedSprinkles(SprinkleSystem& sprinkles, uint64_t seed);
+void spawnSprinkles(SprinkleSystem& sprinkles);
+// Spawns count sprinkles at the nozzle in one go, whether or not the lever is open
+void spawnSprinklesBatch(SprinkleSystem& sprinkles, size_t count);
+// One simulation step on top of the current ice cream; also spawns from the nozzle while open
+void updateSprinklesPhysics(SprinkleSystem& sprinkles, const IceCreamState& iceCream, double deltaTime);
+// The movement half of a step on its own, without state changes (for the benchmarks)
+void integrateSprinkles(SprinkleStore& s, float dt);
+// Whether the last step moved, spawned or settled anything, i.e. whether a frame drawn now
+// would differ from one drawn before it
+bool sprinklesMoving(const SprinkleSystem& sprinkles);
+// Per-instance data for every live sprinkle, alpha of the way from the last step's start to its end
+void buildSprinkleInstances(const SprinkleSystem& sprinkles, float alpha, std::vector<SprinkleInstance>& instances);
+// Per-instance data for sprinkles handed to the toppings layer
+void buildSettledInstances(const SprinkleSystem& sprinkles, std::vector<SprinkleInstance>& instances);
+void resetSprinkles(SprinkleSystem& sprinkles);
+TunnelStats getTunnelStats(const SprinkleSystem& sprinkles);
+// Scatters resting sprinkles over the screen (for --sprinkle-bench)
+void spawnBenchmarkSprinkles(SprinkleSystem& sprinkles, size_t count);
 // Helper function
 float getTunnelY(float x);
 
-#endif
\ No newline at end of file
+#endif
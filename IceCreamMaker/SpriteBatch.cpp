@@ -0,0 +1,197 @@
+#include "SpriteBatch.h"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <GL/glew.h>
+#include "GLState.h"
+#include "Timing.h"
+
+struct SpriteVertex {
+    float x, y, z; // Position (rect.vert takes z, other users leave it 0), then texture coordinates
+    float u, v;
+};
+
+unsigned atlasTexture = 0;
+
+static ShaderProgram batchShader;
+static unsigned int batchVAO = 0;
+static unsigned int batchVBO = 0;
+static size_t batchCapacity = 0; // Vertices the VBO can currently hold
+static std::vector<SpriteVertex> batchVertices;
+
+// Level data is copied into pixel unpack buffers a slice at a time, alternating between two, so
+// filling one overlaps the driver's transfer out of the other
+static const size_t UPLOAD_SLICE_BYTES = 4 << 20;
+
+static void uploadLevel(int level, int width, int height, bool compressed, GLenum internalFormat,
+    const AssetSpan& data, const unsigned int uploadBuffers[2], int& nextBuffer) {
+    // Compressed slices must cover whole 4-row block rows
+    int rowsPerStep = compressed ? 4 : 1;
+    size_t bytesPerStep = compressed ? textureLevelSize(TEXTURE_BC3, width, 4) : (size_t)width * 4;
+    int sliceRows = std::max(1, (int)(UPLOAD_SLICE_BYTES / bytesPerStep)) * rowsPerStep;
+
+    for (int y = 0; y < height; y += sliceRows) {
+        int rows = std::min(sliceRows, height - y);
+        size_t offset = (size_t)(y / rowsPerStep) * bytesPerStep;
+        size_t size = std::min((size_t)((rows + rowsPerStep - 1) / rowsPerStep) * bytesPerStep, data.size - offset);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffers[nextBuffer]);
+        nextBuffer ^= 1;
+        // Orphaning gives fresh storage when the driver is still reading the last slice from it
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!mapped) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            if (compressed) glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, internalFormat, (GLsizei)size, data.data + offset);
+            else glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, data.data + offset);
+            continue;
+        }
+        memcpy(mapped, data.data + offset, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        if (compressed) glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, internalFormat, (GLsizei)size, (void*)0);
+        else glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+bool uploadAtlas(TextureFile& file) {
+    double startTime = timingNow();
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if (file.width > maxSize || file.height > maxSize) {
+        std::cout << "Atlas " << file.width << "x" << file.height
+            << " is larger than the maximum texture size (" << maxSize << ")" << std::endl;
+        return false;
+    }
+    bool compressed = file.format == TEXTURE_BC3;
+    if (compressed && !GLEW_EXT_texture_compression_s3tc) {
+        // Still much cheaper than decoding and packing the PNGs
+        std::vector<std::vector<unsigned char>> decoded(file.levels.size());
+        for (int level = 0; level < (int)file.levels.size(); level++) {
+            decompressBC3(file.levels[level].data, textureLevelWidth(file, level), textureLevelHeight(file, level), decoded[level]);
+        }
+        setTextureLevels(file, decoded);
+        file.format = TEXTURE_RGBA8;
+        compressed = false;
+    }
+    GLenum internalFormat = compressed ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_RGBA8;
+    int levelCount = (int)file.levels.size();
+
+    glGenTextures(1, &atlasTexture);
+    bindTexture2D(0, atlasTexture);
+    // Immutable storage lets the driver allocate every level once, up front
+    if (GLEW_ARB_texture_storage) {
+        glTexStorage2D(GL_TEXTURE_2D, levelCount, internalFormat, file.width, file.height);
+    }
+    else {
+        for (int level = 0; level < levelCount; level++) {
+            int width = textureLevelWidth(file, level), height = textureLevelHeight(file, level);
+            if (compressed) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0,
+                    (GLsizei)file.levels[level].size, NULL);
+            }
+            else {
+                glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            }
+        }
+    }
+    unsigned int uploadBuffers[2];
+    int nextBuffer = 0;
+    glGenBuffers(2, uploadBuffers);
+    for (int level = 0; level < levelCount; level++) {
+        uploadLevel(level, textureLevelWidth(file, level), textureLevelHeight(file, level), compressed, internalFormat,
+            file.levels[level], uploadBuffers, nextBuffer);
+    }
+    glDeleteBuffers(2, uploadBuffers);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    bindTexture2D(0, 0);
+
+    std::cout << "Atlas: " << file.width << "x" << file.height << " " << (compressed ? "BC3" : "RGBA8") << ", "
+        << levelCount << (levelCount == 1 ? " level, " : " levels, ") << textureFileBytes(file) / (1024 * 1024)
+        << " MiB of texture memory, uploaded in " << (timingNow() - startTime) * 1000.0 << " ms" << std::endl;
+    return true;
+}
+
+void initSpriteBatch(const ShaderProgram& rectShader) {
+    batchShader = rectShader;
+    batchVertices.reserve(6 * 64);
+
+    glGenVertexArrays(1, &batchVAO);
+    glGenBuffers(1, &batchVBO);
+    bindVertexArray(batchVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, batchVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    bindVertexArray(0);
+
+    useProgram(batchShader);
+    glUniform1i(batchShader.uniforms[UNIFORM_TEXTURE], 0);
+}
+
+void drawSprite(const Sprite& sprite, float posX, float posY, float scaleX, float scaleY) {
+    drawSpriteQuad(makeSpriteQuad(sprite, posX, posY, scaleX, scaleY));
+}
+
+void drawSpriteQuad(const SpriteQuad& quad, float depth) {
+    // Two triangles per quad so consecutive sprites can share one draw call
+    batchVertices.push_back({ quad.left,  quad.top,    depth, quad.u0, quad.v1 });
+    batchVertices.push_back({ quad.left,  quad.bottom, depth, quad.u0, quad.v0 });
+    batchVertices.push_back({ quad.right, quad.bottom, depth, quad.u1, quad.v0 });
+    batchVertices.push_back({ quad.left,  quad.top,    depth, quad.u0, quad.v1 });
+    batchVertices.push_back({ quad.right, quad.bottom, depth, quad.u1, quad.v0 });
+    batchVertices.push_back({ quad.right, quad.top,    depth, quad.u1, quad.v1 });
+}
+
+void drawSpriteQuadPart(const SpriteQuad& quad, const HullRect& part, float depth) {
+    SpriteQuad piece = quad;
+    float width = quad.right - quad.left, height = quad.top - quad.bottom;
+    float uSpan = quad.u1 - quad.u0, vSpan = quad.v1 - quad.v0;
+    piece.left = quad.left + part.x0 * width;
+    piece.right = quad.left + part.x1 * width;
+    piece.bottom = quad.bottom + part.y0 * height;
+    piece.top = quad.bottom + part.y1 * height;
+    piece.u0 = quad.u0 + part.x0 * uSpan;
+    piece.u1 = quad.u0 + part.x1 * uSpan;
+    piece.v0 = quad.v0 + part.y0 * vSpan;
+    piece.v1 = quad.v0 + part.y1 * vSpan;
+    drawSpriteQuad(piece, depth);
+}
+
+void flushSprites() {
+    if (batchVertices.empty()) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, batchVBO);
+    size_t bytes = batchVertices.size() * sizeof(SpriteVertex);
+    if (batchVertices.size() > batchCapacity) {
+        batchCapacity = batchVertices.capacity();
+    }
+    // Orphan the old storage so the driver doesn't wait for the previous frame's draw
+    glBufferData(GL_ARRAY_BUFFER, batchCapacity * sizeof(SpriteVertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, batchVertices.data());
+
+    // Vertices are emitted already transformed; other users of rect.vert may have moved these
+    useProgram(batchShader);
+    glUniform2f(batchShader.uniforms[UNIFORM_TRANSLATION], 0.0f, 0.0f);
+    glUniform2f(batchShader.uniforms[UNIFORM_SCALE], 1.0f, 1.0f);
+    glUniform1f(batchShader.uniforms[UNIFORM_DEPTH], 0.0f);
+    bindTexture2D(0, atlasTexture);
+    bindVertexArray(batchVAO);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)batchVertices.size());
+
+    batchVertices.clear();
+}
+
+void destroySpriteBatch() {
+    glDeleteBuffers(1, &batchVBO);
+    glDeleteVertexArrays(1, &batchVAO);
+    batchVertices.clear();
+    batchCapacity = 0;
+}
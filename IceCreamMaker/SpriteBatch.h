@@ -0,0 +1,27 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include "Atlas.h"
+#include "DrawList.h"
+#include "GLState.h"
+
+// Global variables
+extern unsigned atlasTexture;
+
+// Function declarations
+// Streams every level of a prepared atlas into atlasTexture through pixel unpack buffers;
+// BC3 goes up as is when the driver takes S3TC
+bool uploadAtlas(TextureFile& file);
+void initSpriteBatch(const ShaderProgram& rectShader);
+// Queues one atlas sprite; arguments match the old drawRect() translation/scale
+void drawSprite(const Sprite& sprite, float posX = 0.0f, float posY = 0.0f,
+    float scaleX = 1.0f, float scaleY = 1.0f);
+// depth is the NDC z the quad is drawn at; it only matters while depth testing is on
+void drawSpriteQuad(const SpriteQuad& quad, float depth = 0.0f);
+// Only the part of the quad the rectangle (0..1 across the quad) covers
+void drawSpriteQuadPart(const SpriteQuad& quad, const HullRect& part, float depth = 0.0f);
+// Uploads every queued quad and draws them with a single call
+void flushSprites();
+void destroySpriteBatch();
+
+#endif
@@ -0,0 +1,453 @@
+#include "TextureFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+// KTX 1.1 header fields, as GL enums
+static const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const uint32_t KTX_ENDIANNESS = 0x04030201;
+static const uint32_t GL_ENUM_UNSIGNED_BYTE = 0x1401;
+static const uint32_t GL_ENUM_RGBA = 0x1908;
+static const uint32_t GL_ENUM_RGBA8 = 0x8058;
+static const uint32_t GL_ENUM_COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+
+int textureLevelWidth(const TextureFile& file, int level) {
+    return std::max(1, file.width >> level);
+}
+
+int textureLevelHeight(const TextureFile& file, int level) {
+    return std::max(1, file.height >> level);
+}
+
+size_t textureLevelSize(TextureFileFormat format, int width, int height) {
+    if (format == TEXTURE_BC3) return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 16;
+    return (size_t)width * height * 4;
+}
+
+size_t textureFileBytes(const TextureFile& file) {
+    size_t total = 0;
+    for (const AssetSpan& level : file.levels) total += level.size;
+    return total;
+}
+
+void setTextureLevels(TextureFile& file, std::vector<std::vector<unsigned char>>& levels) {
+    file.storage.swap(levels);
+    levels.clear();
+    file.levels.clear();
+    for (const auto& level : file.storage) {
+        AssetSpan span;
+        span.data = level.data();
+        span.size = level.size();
+        file.levels.push_back(span);
+    }
+}
+
+void buildMipChain(const unsigned char* rgba, int width, int height, int levelCount,
+    std::vector<std::vector<unsigned char>>& levels) {
+    levels.assign(1, std::vector<unsigned char>(rgba, rgba + (size_t)width * height * 4));
+    for (int level = 1; level < levelCount && (width > 1 || height > 1); level++) {
+        const std::vector<unsigned char>& src = levels.back();
+        int dstWidth = std::max(1, width / 2), dstHeight = std::max(1, height / 2);
+        std::vector<unsigned char> dst((size_t)dstWidth * dstHeight * 4);
+        for (int y = 0; y < dstHeight; y++) {
+            for (int x = 0; x < dstWidth; x++) {
+                const unsigned char* p[4] = {
+                    &src[((size_t)std::min(2 * y, height - 1) * width + std::min(2 * x, width - 1)) * 4],
+                    &src[((size_t)std::min(2 * y, height - 1) * width + std::min(2 * x + 1, width - 1)) * 4],
+                    &src[((size_t)std::min(2 * y + 1, height - 1) * width + std::min(2 * x, width - 1)) * 4],
+                    &src[((size_t)std::min(2 * y + 1, height - 1) * width + std::min(2 * x + 1, width - 1)) * 4]
+                };
+                unsigned char* out = &dst[((size_t)y * dstWidth + x) * 4];
+                int alphaSum = p[0][3] + p[1][3] + p[2][3] + p[3][3];
+                for (int c = 0; c < 3; c++) {
+                    if (alphaSum == 0) {
+                        out[c] = (unsigned char)((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+                    }
+                    else {
+                        int weighted = p[0][c] * p[0][3] + p[1][c] * p[1][3] + p[2][c] * p[2][3] + p[3][c] * p[3][3];
+                        out[c] = (unsigned char)((weighted + alphaSum / 2) / alphaSum);
+                    }
+                }
+                out[3] = (unsigned char)((alphaSum + 2) / 4);
+            }
+        }
+        levels.push_back(std::move(dst));
+        width = dstWidth;
+        height = dstHeight;
+    }
+}
+
+// BC3 color half: two RGB565 endpoints and a 2-bit index per pixel, always in 4-color mode
+
+static uint16_t toRGB565(const float color[3]) {
+    int r = (int)(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    int g = (int)(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+    int b = (int)(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void fromRGB565(uint16_t color, int out[3]) {
+    int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+static void colorPalette(uint16_t c0, uint16_t c1, int palette[4][3]) {
+    fromRGB565(c0, palette[0]);
+    fromRGB565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+}
+
+// Picks the nearest palette entry for every pixel; the error only counts visible pixels
+static int fitColorIndices(const unsigned char pixels[16][4], bool anyVisible, uint16_t c0, uint16_t c1, uint32_t& indices) {
+    int palette[4][3];
+    colorPalette(c0, c1, palette);
+    // Equal endpoints would select 3-color mode, so those blocks use index 0 everywhere
+    int choices = c0 == c1 ? 1 : 4;
+    int total = 0;
+    indices = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestError = 1 << 30;
+        for (int p = 0; p < choices; p++) {
+            int dr = pixels[i][0] - palette[p][0], dg = pixels[i][1] - palette[p][1], db = pixels[i][2] - palette[p][2];
+            int error = dr * dr + dg * dg + db * db;
+            if (error < bestError) { bestError = error; best = p; }
+        }
+        if (!anyVisible || pixels[i][3] > 0) total += bestError;
+        indices |= (uint32_t)best << (2 * i);
+    }
+    return total;
+}
+
+static void orderEndpoints(uint16_t& c0, uint16_t& c1) {
+    if (c0 < c1) std::swap(c0, c1);
+}
+
+static void encodeColorBlock(const unsigned char pixels[16][4], unsigned char* out) {
+    // Endpoints are fitted to the pixels that can be seen; transparent ones just take the nearest index
+    bool anyVisible = false;
+    for (int i = 0; i < 16; i++) anyVisible |= pixels[i][3] > 0;
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    int used = 0;
+    for (int i = 0; i < 16; i++) {
+        if (anyVisible && pixels[i][3] == 0) continue;
+        for (int c = 0; c < 3; c++) mean[c] += pixels[i][c];
+        used++;
+    }
+    for (int c = 0; c < 3; c++) mean[c] /= used;
+
+    // Principal axis of the colors by power iteration on their covariance
+    float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++) {
+        if (anyVisible && pixels[i][3] == 0) continue;
+        float r = pixels[i][0] - mean[0], g = pixels[i][1] - mean[1], b = pixels[i][2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[3] = {
+            cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+            cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+            cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]
+        };
+        float largest = std::max(std::fabs(next[0]), std::max(std::fabs(next[1]), std::fabs(next[2])));
+        if (largest < 1e-6f) break;
+        for (int c = 0; c < 3; c++) axis[c] = next[c] / largest;
+    }
+
+    int lowest = -1, highest = -1;
+    float lowestProjection = 0.0f, highestProjection = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        if (anyVisible && pixels[i][3] == 0) continue;
+        float projection = pixels[i][0] * axis[0] + pixels[i][1] * axis[1] + pixels[i][2] * axis[2];
+        if (lowest < 0 || projection < lowestProjection) { lowest = i; lowestProjection = projection; }
+        if (highest < 0 || projection > highestProjection) { highest = i; highestProjection = projection; }
+    }
+
+    // Pull both ends in a little, since the extremes are rarely worth an exact match
+    float high[3], low[3];
+    for (int c = 0; c < 3; c++) {
+        float inset = ((float)pixels[highest][c] - pixels[lowest][c]) / 16.0f;
+        high[c] = pixels[highest][c] - inset;
+        low[c] = pixels[lowest][c] + inset;
+    }
+    uint16_t c0 = toRGB565(high), c1 = toRGB565(low);
+    orderEndpoints(c0, c1);
+    uint32_t indices;
+    int error = fitColorIndices(pixels, anyVisible, c0, c1, indices);
+
+    // Least-squares endpoints for the chosen indices, kept when they fit better
+    if (c0 != c1 && error > 0) {
+        static const float WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++) {
+            if (anyVisible && pixels[i][3] == 0) continue;
+            float w = WEIGHTS[(indices >> (2 * i)) & 3];
+            aa += w * w;
+            ab += w * (1.0f - w);
+            bb += (1.0f - w) * (1.0f - w);
+            for (int c = 0; c < 3; c++) {
+                ax[c] += w * pixels[i][c];
+                bx[c] += (1.0f - w) * pixels[i][c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) > 1e-6f) {
+            for (int c = 0; c < 3; c++) {
+                high[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+                low[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+            }
+            uint16_t r0 = toRGB565(high), r1 = toRGB565(low);
+            orderEndpoints(r0, r1);
+            uint32_t refinedIndices;
+            int refinedError = fitColorIndices(pixels, anyVisible, r0, r1, refinedIndices);
+            if (refinedError < error) {
+                c0 = r0;
+                c1 = r1;
+                indices = refinedIndices;
+            }
+        }
+    }
+    out[0] = (unsigned char)(c0 & 255); out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 255); out[3] = (unsigned char)(c1 >> 8);
+    for (int b = 0; b < 4; b++) out[4 + b] = (unsigned char)(indices >> (8 * b));
+}
+
+// BC3 alpha half: two endpoints and a 3-bit index per pixel. With a0 > a1 there are
+// eight evenly spaced values; otherwise six plus exact 0 and 255.
+
+static void alphaPalette(int a0, int a1, int palette[8]) {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i <= 6; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    }
+    else {
+        for (int i = 1; i <= 4; i++) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static int fitAlpha(const unsigned char pixels[16][4], int a0, int a1, uint64_t& indices) {
+    int palette[8];
+    alphaPalette(a0, a1, palette);
+    int total = 0;
+    indices = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestError = 1 << 30;
+        for (int p = 0; p < 8; p++) {
+            int error = std::abs(pixels[i][3] - palette[p]);
+            if (error < bestError) { bestError = error; best = p; }
+        }
+        total += bestError * bestError;
+        indices |= (uint64_t)best << (3 * i);
+    }
+    return total;
+}
+
+static void encodeAlphaBlock(const unsigned char pixels[16][4], unsigned char* out) {
+    int lowest = 255, highest = 0, innerLowest = 255, innerHighest = 0;
+    for (int i = 0; i < 16; i++) {
+        int a = pixels[i][3];
+        lowest = std::min(lowest, a);
+        highest = std::max(highest, a);
+        if (a != 0 && a != 255) {
+            innerLowest = std::min(innerLowest, a);
+            innerHighest = std::max(innerHighest, a);
+        }
+    }
+    if (innerLowest > innerHighest) innerLowest = innerHighest = 0;
+
+    int a0 = highest, a1 = lowest;
+    uint64_t indices = 0;
+    if (a0 != a1) {
+        // Eight steps across the whole range, or six across the partial values plus exact 0/255
+        uint64_t innerIndices;
+        int error = fitAlpha(pixels, a0, a1, indices);
+        if (fitAlpha(pixels, innerLowest, innerHighest, innerIndices) < error) {
+            a0 = innerLowest;
+            a1 = innerHighest;
+            indices = innerIndices;
+        }
+    }
+    out[0] = (unsigned char)a0;
+    out[1] = (unsigned char)a1;
+    for (int b = 0; b < 6; b++) out[2 + b] = (unsigned char)(indices >> (8 * b));
+}
+
+void compressBC3(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& blocks) {
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    blocks.resize((size_t)blocksX * blocksY * 16);
+    unsigned char pixels[16][4];
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            // Blocks past the edge repeat the last row and column
+            for (int i = 0; i < 16; i++) {
+                int x = std::min(bx * 4 + (i & 3), width - 1);
+                int y = std::min(by * 4 + (i >> 2), height - 1);
+                memcpy(pixels[i], rgba + ((size_t)y * width + x) * 4, 4);
+            }
+            unsigned char* out = &blocks[((size_t)by * blocksX + bx) * 16];
+            encodeAlphaBlock(pixels, out);
+            encodeColorBlock(pixels, out + 8);
+        }
+    }
+}
+
+void decompressBC3(const unsigned char* blocks, int width, int height, std::vector<unsigned char>& rgba) {
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    rgba.resize((size_t)width * height * 4);
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            const unsigned char* block = blocks + ((size_t)by * blocksX + bx) * 16;
+            int alphas[8], colors[4][3];
+            alphaPalette(block[0], block[1], alphas);
+            uint64_t alphaIndices = 0;
+            for (int b = 0; b < 6; b++) alphaIndices |= (uint64_t)block[2 + b] << (8 * b);
+            colorPalette((uint16_t)(block[8] | (block[9] << 8)), (uint16_t)(block[10] | (block[11] << 8)), colors);
+            uint32_t colorIndices = block[12] | (block[13] << 8) | (block[14] << 16) | ((uint32_t)block[15] << 24);
+
+            for (int i = 0; i < 16; i++) {
+                int x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+                if (x >= width || y >= height) continue;
+                unsigned char* out = &rgba[((size_t)y * width + x) * 4];
+                const int* color = colors[(colorIndices >> (2 * i)) & 3];
+                out[0] = (unsigned char)color[0];
+                out[1] = (unsigned char)color[1];
+                out[2] = (unsigned char)color[2];
+                out[3] = (unsigned char)alphas[(alphaIndices >> (3 * i)) & 7];
+            }
+        }
+    }
+}
+
+static void writeUint32(std::ofstream& out, uint32_t value) {
+    out.write((const char*)&value, sizeof(value));
+}
+
+bool writeTextureFile(const std::string& path, const TextureFile& file) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cout << "Failed to write " << path << std::endl;
+        return false;
+    }
+
+    std::vector<char> keyValueData;
+    for (const auto& entry : file.keyValues) {
+        uint32_t size = (uint32_t)(entry.first.size() + 1 + entry.second.size() + 1);
+        const char* sizeBytes = (const char*)&size;
+        keyValueData.insert(keyValueData.end(), sizeBytes, sizeBytes + 4);
+        keyValueData.insert(keyValueData.end(), entry.first.c_str(), entry.first.c_str() + entry.first.size() + 1);
+        keyValueData.insert(keyValueData.end(), entry.second.c_str(), entry.second.c_str() + entry.second.size() + 1);
+        while (keyValueData.size() % 4 != 0) keyValueData.push_back(0);
+    }
+
+    bool compressed = file.format == TEXTURE_BC3;
+    out.write((const char*)KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    writeUint32(out, KTX_ENDIANNESS);
+    writeUint32(out, compressed ? 0 : GL_ENUM_UNSIGNED_BYTE); // glType
+    writeUint32(out, 1);                                     // glTypeSize
+    writeUint32(out, compressed ? 0 : GL_ENUM_RGBA);         // glFormat
+    writeUint32(out, compressed ? GL_ENUM_COMPRESSED_RGBA_S3TC_DXT5 : GL_ENUM_RGBA8);
+    writeUint32(out, GL_ENUM_RGBA);                          // glBaseInternalFormat
+    writeUint32(out, (uint32_t)file.width);
+    writeUint32(out, (uint32_t)file.height);
+    writeUint32(out, 0);                                     // pixelDepth
+    writeUint32(out, 0);                                     // numberOfArrayElements
+    writeUint32(out, 1);                                     // numberOfFaces
+    writeUint32(out, (uint32_t)file.levels.size());
+    writeUint32(out, (uint32_t)keyValueData.size());
+    out.write(keyValueData.data(), keyValueData.size());
+    // Every level size is a multiple of 4 for both formats, so no mip padding is needed
+    for (const AssetSpan& level : file.levels) {
+        writeUint32(out, (uint32_t)level.size);
+        out.write((const char*)level.data, level.size);
+    }
+    return (bool)out;
+}
+
+bool readTextureFile(const std::string& path, TextureFile& file) {
+    AssetSpan asset;
+    std::vector<unsigned char> bytes;
+    if (!loadAsset(path.c_str(), asset, bytes)) return false;
+    file.storage.clear();
+    if (!bytes.empty()) file.storage.push_back(std::move(bytes)); // Moving keeps asset.data valid
+    const unsigned char* data = asset.data;
+    const size_t dataSize = asset.size;
+
+    const size_t HEADER_SIZE = 12 + 13 * 4;
+    if (dataSize < HEADER_SIZE || memcmp(data, KTX_IDENTIFIER, 12) != 0) {
+        std::cout << path << " is not a KTX file" << std::endl;
+        return false;
+    }
+    uint32_t header[13];
+    memcpy(header, &data[12], sizeof(header));
+    if (header[0] != KTX_ENDIANNESS || header[8] > 1 || header[9] > 1 || header[10] != 1) {
+        std::cout << path << ": only little-endian 2D KTX files are supported" << std::endl;
+        return false;
+    }
+    if (header[4] == GL_ENUM_COMPRESSED_RGBA_S3TC_DXT5) file.format = TEXTURE_BC3;
+    else if (header[4] == GL_ENUM_RGBA8 && header[1] == GL_ENUM_UNSIGNED_BYTE) file.format = TEXTURE_RGBA8;
+    else {
+        std::cout << path << ": unsupported format 0x" << std::hex << header[4] << std::dec << std::endl;
+        return false;
+    }
+    file.width = (int)header[6];
+    file.height = (int)std::max(header[7], 1u);
+    uint32_t levelCount = std::max(header[11], 1u);
+
+    size_t offset = HEADER_SIZE;
+    size_t keyValueEnd = offset + header[12];
+    if (keyValueEnd > dataSize) return false;
+    file.keyValues.clear();
+    while (offset + 4 <= keyValueEnd) {
+        uint32_t size;
+        memcpy(&size, &data[offset], 4);
+        offset += 4;
+        if (offset + size > keyValueEnd) return false;
+        const char* entry = (const char*)&data[offset];
+        size_t keyLength = strnlen(entry, size);
+        std::string key(entry, keyLength);
+        std::string value;
+        if (keyLength + 1 < size) {
+            value.assign(entry + keyLength + 1, size - keyLength - 1);
+            if (!value.empty() && value.back() == '\0') value.pop_back();
+        }
+        file.keyValues.push_back(std::make_pair(key, value));
+        offset += (size + 3) & ~3u;
+    }
+    offset = keyValueEnd;
+
+    file.levels.assign(levelCount, AssetSpan());
+    for (uint32_t level = 0; level < levelCount; level++) {
+        uint32_t size;
+        if (offset + 4 > dataSize) return false;
+        memcpy(&size, &data[offset], 4);
+        offset += 4;
+        size_t expected = textureLevelSize(file.format, textureLevelWidth(file, level), textureLevelHeight(file, level));
+        if (size != expected || offset + size > dataSize) {
+            std::cout << path << ": level " << level << " has the wrong size" << std::endl;
+            return false;
+        }
+        file.levels[level].data = data + offset;
+        file.levels[level].size = size;
+        offset += (size + 3) & ~3u;
+    }
+    return true;
+}
+
+std::string findTextureValue(const TextureFile& file, const std::string& key) {
+    for (const auto& entry : file.keyValues) {
+        if (entry.first == key) return entry.second;
+    }
+    return std::string();
+}
@@ -0,0 +1,44 @@
+#ifndef TEXTURE_FILE_H
+#define TEXTURE_FILE_H
+
+// Pre-built textures on disk: KTX 1.1 files holding every mip level, bottom row first,
+// either as plain RGBA8 or BC3 (DXT5) blocks that GL can upload without decoding.
+
+#include <vector>
+#include <string>
+#include "AssetPack.h"
+
+enum TextureFileFormat {
+    TEXTURE_RGBA8,
+    TEXTURE_BC3
+};
+
+struct TextureFile {
+    TextureFileFormat format = TEXTURE_RGBA8;
+    int width = 0, height = 0;
+    std::vector<AssetSpan> levels;                   // Level 0 first, into storage or a mapped asset pack
+    std::vector<std::vector<unsigned char>> storage; // Whatever the levels point at that this file owns
+    std::vector<std::pair<std::string, std::string>> keyValues;
+};
+
+// Function declarations
+int textureLevelWidth(const TextureFile& file, int level);
+int textureLevelHeight(const TextureFile& file, int level);
+// Bytes one level of the given size takes in this format
+size_t textureLevelSize(TextureFileFormat format, int width, int height);
+size_t textureFileBytes(const TextureFile& file);
+// Fills levels with the RGBA image and levelCount - 1 halvings of it. Colors are averaged by
+// alpha, so transparent neighbours don't darken the edges of what is visible.
+void buildMipChain(const unsigned char* rgba, int width, int height, int levelCount,
+    std::vector<std::vector<unsigned char>>& levels);
+// Hands the levels over to the file (they are moved, not copied) and points levels at them
+void setTextureLevels(TextureFile& file, std::vector<std::vector<unsigned char>>& levels);
+void compressBC3(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& blocks);
+void decompressBC3(const unsigned char* blocks, int width, int height, std::vector<unsigned char>& rgba);
+bool writeTextureFile(const std::string& path, const TextureFile& file);
+// Through loadAsset(), so a packed file is used in place
+bool readTextureFile(const std::string& path, TextureFile& file);
+// Empty when the key is missing
+std::string findTextureValue(const TextureFile& file, const std::string& key);
+
+#endif
@@ -0,0 +1,187 @@
+#include "Timing.h"
+#include <chrono>
+#include <thread>
+#include <cmath>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#else
+#include <time.h>
+#endif
+
+// Constants
+static const double MIN_SPIN_MARGIN = 0.0002;
+static const double MAX_SPIN_MARGIN = 0.004;
+static const double SPIN_MARGIN_DECAY = 0.995; // Per frame, so one bad sleep is forgotten after a few seconds
+
+void initFixedStepClock(FixedStepClock& clock, double stepsPerSecond, int maxStepsPerFrame) {
+    clock.stepSize = 1.0 / stepsPerSecond;
+    clock.maxStepsPerFrame = maxStepsPerFrame > 0 ? maxStepsPerFrame : 1;
+    clock.accumulator = 0.0;
+    clock.simulationTime = 0.0;
+    clock.steps = 0;
+    clock.droppedTime = 0.0;
+}
+
+int advanceFixedStepClock(FixedStepClock& clock, double frameTime) {
+    if (frameTime < 0.0) frameTime = 0.0;
+    clock.accumulator += frameTime;
+
+    int stepCount = (int)(clock.accumulator / clock.stepSize);
+    if (stepCount > clock.maxStepsPerFrame) {
+        // Keep the fractional part so alpha stays continuous, drop whole steps beyond the cap
+        double excess = (stepCount - clock.maxStepsPerFrame) * clock.stepSize;
+        clock.accumulator -= excess;
+        clock.droppedTime += excess;
+        stepCount = clock.maxStepsPerFrame;
+    }
+
+    clock.accumulator -= stepCount * clock.stepSize;
+    if (clock.accumulator < 0.0) clock.accumulator = 0.0;
+    clock.simulationTime += stepCount * clock.stepSize;
+    clock.steps += stepCount;
+    return stepCount;
+}
+
+float fixedStepAlpha(const FixedStepClock& clock) {
+    float alpha = (float)(clock.accumulator / clock.stepSize);
+    return alpha > 1.0f ? 1.0f : alpha;
+}
+
+double timingNow() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+double processCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) return 0.0;
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernelTime.dwLowDateTime;
+    kernel.HighPart = kernelTime.dwHighDateTime;
+    user.LowPart = userTime.dwLowDateTime;
+    user.HighPart = userTime.dwHighDateTime;
+    return (double)(kernel.QuadPart + user.QuadPart) * 1e-7; // 100 ns units
+#else
+    timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+}
+
+void initFramePacer(FramePacer& pacer, FramePacingMode mode, double refreshRate) {
+    double now = timingNow();
+    pacer = FramePacer();
+    pacer.mode = mode;
+    pacer.interval = 1.0 / (refreshRate > 0.0 ? refreshRate : 60.0);
+    pacer.nextDeadline = now + pacer.interval;
+    pacer.windowStart = now;
+    pacer.lastFrameEnd = now;
+    pacer.cpuStart = processCpuSeconds();
+
+#ifdef _WIN32
+    // The default 15.6 ms scheduler tick would make every sleep overshoot a whole frame
+    if (mode == PACING_HYBRID) timeBeginPeriod(1);
+#endif
+}
+
+void waitForNextFrame(FramePacer& pacer) {
+    double now = timingNow();
+    double error;
+
+    if (pacer.mode == PACING_VSYNC) {
+        // Nothing to wait for; judge the swap by how far the interval strays from the refresh
+        error = std::fabs((now - pacer.lastFrameEnd) - pacer.interval);
+    }
+    else {
+        if (pacer.mode == PACING_HYBRID) {
+            double sleepTime = pacer.nextDeadline - now - pacer.spinMargin;
+            if (sleepTime > 0.0) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(sleepTime));
+                now = timingNow();
+
+                // Learn how late the OS wakes us up and stop sleeping that much earlier
+                double oversleep = now - (pacer.nextDeadline - pacer.spinMargin);
+                double margin = pacer.spinMargin * SPIN_MARGIN_DECAY;
+                if (oversleep > margin) margin = oversleep;
+                if (margin < MIN_SPIN_MARGIN) margin = MIN_SPIN_MARGIN;
+                if (margin > MAX_SPIN_MARGIN) margin = MAX_SPIN_MARGIN;
+                pacer.spinMargin = margin;
+            }
+        }
+
+        // Only the last fraction of a millisecond is spent spinning
+        while (now < pacer.nextDeadline) {
+            now = timingNow();
+        }
+        error = now - pacer.nextDeadline;
+
+        // Keep the cadence after a slightly late frame, but don't try to catch up after a long one
+        pacer.nextDeadline += pacer.interval;
+        if (pacer.nextDeadline <= now) pacer.nextDeadline = now + pacer.interval;
+    }
+
+    double frameTime = now - pacer.lastFrameEnd;
+    pacer.lastFrameEnd = now;
+    pacer.frames++;
+    pacer.errorSum += error;
+    if (error > pacer.errorMax) pacer.errorMax = error;
+    pacer.intervalSum += frameTime;
+    pacer.intervalSquareSum += frameTime * frameTime;
+}
+
+bool takeFramePacingReport(FramePacer& pacer, double period, FramePacingReport& report) {
+    double now = timingNow();
+    double elapsed = now - pacer.windowStart;
+    if (elapsed < period || (pacer.frames == 0 && pacer.idleTime == 0.0)) return false;
+
+    double cpuNow = processCpuSeconds();
+    double frames = pacer.frames > 0 ? pacer.frames : 1;
+    double meanInterval = pacer.intervalSum / frames;
+    double variance = pacer.intervalSquareSum / frames - meanInterval * meanInterval;
+
+    report.fps = pacer.frames / elapsed;
+    report.meanErrorMs = pacer.errorSum / frames * 1000.0;
+    report.maxErrorMs = pacer.errorMax * 1000.0;
+    report.jitterMs = std::sqrt(variance > 0.0 ? variance : 0.0) * 1000.0;
+    report.cpuPercent = (cpuNow - pacer.cpuStart) / elapsed * 100.0;
+    report.idlePercent = pacer.idleTime / elapsed * 100.0;
+
+    pacer.frames = 0;
+    pacer.windowStart = now;
+    pacer.cpuStart = cpuNow;
+    pacer.errorSum = pacer.errorMax = 0.0;
+    pacer.intervalSum = pacer.intervalSquareSum = 0.0;
+    pacer.idleTime = 0.0;
+    return true;
+}
+
+void resumeFramePacer(FramePacer& pacer, double idleSeconds) {
+    double now = timingNow();
+    pacer.idleTime += idleSeconds;
+    pacer.nextDeadline = now + pacer.interval;
+    pacer.lastFrameEnd = now;
+}
+
+void destroyFramePacer(FramePacer& pacer) {
+#ifdef _WIN32
+    if (pacer.mode == PACING_HYBRID) timeEndPeriod(1);
+#endif
+}
+
+void initIdleTracker(IdleTracker& tracker, double idleDelay) {
+    tracker.idleDelay = idleDelay;
+    tracker.lastActivity = timingNow();
+}
+
+void noteActivity(IdleTracker& tracker) {
+    tracker.lastActivity = timingNow();
+}
+
+bool isIdle(const IdleTracker& tracker) {
+    return timingNow() - tracker.lastActivity >= tracker.idleDelay;
+}
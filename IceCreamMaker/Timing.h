@@ -0,0 +1,81 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+// Fixed-step simulation clock. Frame time goes into an accumulator that is drained in
+// steps of exactly stepSize, so the simulation behaves the same at any frame rate.
+// After a long hitch at most maxStepsPerFrame run and the rest of the backlog is dropped,
+// which slows the simulation down for a moment instead of spiralling.
+struct FixedStepClock {
+    double stepSize = 1.0 / 120.0;
+    int maxStepsPerFrame = 8;
+    double accumulator = 0.0;
+    double simulationTime = 0.0;      // Sum of all steps taken
+    unsigned long long steps = 0;
+    double droppedTime = 0.0;         // Backlog thrown away by the catch-up cap
+};
+
+// How the render loop waits for the next frame
+enum FramePacingMode {
+    PACING_SPIN,   // Busy-wait until the deadline (the old limitFPS); exact but burns a core
+    PACING_HYBRID, // Sleep most of the wait, spin only the last fraction of a millisecond
+    PACING_VSYNC   // The swap already blocks on the display, only measure
+};
+
+// Paces the render loop to a fixed frame interval and measures how well it holds it
+struct FramePacer {
+    FramePacingMode mode = PACING_HYBRID;
+    double interval = 1.0 / 60.0;
+    double nextDeadline = 0.0;
+    double spinMargin = 0.0005;     // Sleep stops this early; grows with the oversleep we observe
+
+    // Current measurement window
+    unsigned frames = 0;
+    double windowStart = 0.0;
+    double cpuStart = 0.0;
+    double lastFrameEnd = 0.0;
+    double errorSum = 0.0, errorMax = 0.0;
+    double intervalSum = 0.0, intervalSquareSum = 0.0;
+    double idleTime = 0.0;          // Spent waiting for input instead of drawing
+};
+
+struct FramePacingReport {
+    double fps;
+    double meanErrorMs;   // How late frames were released, relative to their deadline
+    double maxErrorMs;
+    double jitterMs;      // Standard deviation of the frame-to-frame interval
+    double cpuPercent;    // Process CPU time over wall time; 100 = one full core
+    double idlePercent;   // Wall time the loop spent waiting for input with nothing to draw
+};
+
+// Tells the render loop when drawing can stop: the scene is idle once nothing has changed for
+// idleDelay seconds, which also lets the frames interpolating the last step reach the screen
+struct IdleTracker {
+    double idleDelay = 0.25;
+    double lastActivity = 0.0;
+};
+
+// Function declarations
+void initFixedStepClock(FixedStepClock& clock, double stepsPerSecond, int maxStepsPerFrame);
+// Adds a frame's worth of real time and returns how many steps to simulate now
+int advanceFixedStepClock(FixedStepClock& clock, double frameTime);
+// How far the leftover time is into the next step, 0..1; render at lerp(previous, current, alpha)
+float fixedStepAlpha(const FixedStepClock& clock);
+
+// Monotonic seconds and process CPU seconds (all threads)
+double timingNow();
+double processCpuSeconds();
+void initFramePacer(FramePacer& pacer, FramePacingMode mode, double refreshRate);
+// Blocks until the next frame is due (not in PACING_VSYNC) and records the frame
+void waitForNextFrame(FramePacer& pacer);
+// Fills report and starts a new window once at least period seconds have been measured
+bool takeFramePacingReport(FramePacer& pacer, double period, FramePacingReport& report);
+// Restarts the cadence after the loop sat idle for idleSeconds, so the gap counts as idle time
+// rather than one very late frame
+void resumeFramePacer(FramePacer& pacer, double idleSeconds);
+void destroyFramePacer(FramePacer& pacer);
+void initIdleTracker(IdleTracker& tracker, double idleDelay);
+// Something changed on screen (or is about to)
+void noteActivity(IdleTracker& tracker);
+bool isIdle(const IdleTracker& tracker);
+
+#endif
@@ -0,0 +1,132 @@
+#include "Toppings.h"
+#include "SprinkleRenderer.h"
+#include <GL/glew.h>
+#include <iostream>
+
+static ShaderProgram toppingsRectShader;
+static ShaderProgram toppingsParticleShader;
+static unsigned int toppingsParticleVAO = 0;
+static unsigned int toppingsFBO = 0;
+static unsigned int toppingsTexture = 0;
+static unsigned int toppingsVAO = 0;
+static unsigned int toppingsVBO = 0;
+static int toppingsWidth = 0, toppingsHeight = 0;
+static int viewportWidth = 0, viewportHeight = 0;
+static unsigned int bakedResetCount = 0;
+static bool toppingsEmpty = true;
+static std::vector<SprinkleInstance> bakeInstances;
+
+// Screen-space center and half size of the layer
+static const float CENTER_X = (TOPPINGS_LEFT + TOPPINGS_RIGHT) * 0.5f;
+static const float CENTER_Y = (TOPPINGS_BOTTOM + TOPPINGS_TOP) * 0.5f;
+static const float HALF_WIDTH = (TOPPINGS_RIGHT - TOPPINGS_LEFT) * 0.5f;
+static const float HALF_HEIGHT = (TOPPINGS_TOP - TOPPINGS_BOTTOM) * 0.5f;
+
+void initToppings(const ShaderProgram& rectShader, const ShaderProgram& particleShader, unsigned int particleVAO,
+    int screenWidth, int screenHeight, const SprinkleSystem& sprinkles) {
+    toppingsRectShader = rectShader;
+    toppingsParticleShader = particleShader;
+    toppingsParticleVAO = particleVAO;
+    viewportWidth = screenWidth;
+    viewportHeight = screenHeight;
+    bakedResetCount = sprinkles.resetCount;
+
+    // Same pixel density as the screen, so baked sprinkles look exactly like live ones
+    toppingsWidth = (int)(HALF_WIDTH * screenWidth + 0.5f);
+    toppingsHeight = (int)(HALF_HEIGHT * screenHeight + 0.5f);
+
+    glGenTextures(1, &toppingsTexture);
+    bindTexture2D(0, toppingsTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, toppingsWidth, toppingsHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    bindTexture2D(0, 0);
+
+    glGenFramebuffers(1, &toppingsFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, toppingsFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, toppingsTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Toppings framebuffer is incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    float layerVertices[] = {
+        -1.0f,  1.0f,   0.0f, 1.0f,
+        -1.0f, -1.0f,   0.0f, 0.0f,
+         1.0f, -1.0f,   1.0f, 0.0f,
+         1.0f,  1.0f,   1.0f, 1.0f
+    };
+    glGenVertexArrays(1, &toppingsVAO);
+    glGenBuffers(1, &toppingsVBO);
+    bindVertexArray(toppingsVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, toppingsVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(layerVertices), layerVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    bindVertexArray(0);
+
+    clearToppings();
+}
+
+void clearToppings() {
+    float clearColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    glBindFramebuffer(GL_FRAMEBUFFER, toppingsFBO);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+    toppingsEmpty = true;
+}
+
+void bakeToppings(SprinkleSystem& sprinkles) {
+    if (sprinkles.settled.empty()) bakeInstances.clear();
+    else buildSettledInstances(sprinkles, bakeInstances);
+    sprinkles.settled.clear();
+    bakeToppingInstances(sprinkles.resetCount, bakeInstances);
+}
+
+void bakeToppingInstances(unsigned int resetCount, const std::vector<SprinkleInstance>& instances) {
+    // resetSprinkles() was called since the last bake: the cup is empty again
+    if (bakedResetCount != resetCount) {
+        bakedResetCount = resetCount;
+        if (!toppingsEmpty) clearToppings();
+    }
+    if (instances.empty()) return;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, toppingsFBO);
+    glViewport(0, 0, toppingsWidth, toppingsHeight);
+    useProgram(toppingsParticleShader);
+    int viewLoc = toppingsParticleShader.uniforms[UNIFORM_VIEW];
+    glUniform4f(viewLoc, CENTER_X, CENTER_Y, HALF_WIDTH, HALF_HEIGHT);
+
+    drawSprinkleInstances(toppingsParticleShader, toppingsParticleVAO, instances.data(), instances.size());
+
+    glUniform4f(viewLoc, 0.0f, 0.0f, 1.0f, 1.0f);
+    glViewport(0, 0, viewportWidth, viewportHeight);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    toppingsEmpty = false;
+}
+
+void drawToppings(float depth) {
+    if (toppingsEmpty) return;
+
+    useProgram(toppingsRectShader);
+    glUniform2f(toppingsRectShader.uniforms[UNIFORM_TRANSLATION], CENTER_X, CENTER_Y);
+    glUniform2f(toppingsRectShader.uniforms[UNIFORM_SCALE], HALF_WIDTH, HALF_HEIGHT);
+    glUniform1f(toppingsRectShader.uniforms[UNIFORM_DEPTH], depth);
+    bindTexture2D(0, toppingsTexture);
+    bindVertexArray(toppingsVAO);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+}
+
+void destroyToppings() {
+    glDeleteFramebuffers(1, &toppingsFBO);
+    glDeleteTextures(1, &toppingsTexture);
+    glDeleteBuffers(1, &toppingsVBO);
+    glDeleteVertexArrays(1, &toppingsVAO);
+}
@@ -0,0 +1,24 @@
+#ifndef TOPPINGS_H
+#define TOPPINGS_H
+
+// Persistent layer the settled sprinkles are baked into. It covers the
+// TOPPINGS_* area around the cup, so the cup can hold any number of sprinkles
+// while the simulation only keeps the moving ones.
+
+#include "Sprinkles.h"
+#include "GLState.h"
+
+// Function declarations
+void initToppings(const ShaderProgram& rectShader, const ShaderProgram& particleShader, unsigned int particleVAO,
+    int screenWidth, int screenHeight, const SprinkleSystem& sprinkles);
+// Renders sprinkles that settled since the last call into the layer; call before the frame starts drawing
+void bakeToppings(SprinkleSystem& sprinkles);
+// The same for sprinkles already turned into instances elsewhere (the render thread gets them in a
+// FrameSnapshot); resetCount is the sprinkles' at the time they were taken
+void bakeToppingInstances(unsigned int resetCount, const std::vector<SprinkleInstance>& instances);
+// depth is the NDC z the layer is drawn at; it only matters while depth testing is on
+void drawToppings(float depth = 0.0f);
+void clearToppings();
+void destroyToppings();
+
+#endif
@@ -0,0 +1,50 @@
+// Checks that the sprinkle tunnel keeps letting sprinkles out at its exit interval while the
+// nozzle feeds it faster than that, and that its queue stays bounded by the sprinkle pool.
+// Built and run by `make check`; exits with 1 if any run fails.
+#include <iostream>
+#include "Simulation.h"
+
+struct TunnelRun {
+    unsigned long long exitsFirstHalf, exitsSecondHalf;
+    size_t maxQueueDepth;
+};
+
+static TunnelRun runTunnel(float exitInterval, double seconds, double simulationHz) {
+    SimulationContext simulation;
+    initSimulation(simulation);
+    seedSprinkles(simulation.sprinkles, 1);
+    simulation.sprinkles.tunnelExitInterval = exitInterval;
+    toggleSprinkles(simulation);
+
+    const unsigned long long steps = (unsigned long long)(seconds * simulationHz + 0.5);
+    TunnelRun run = {};
+    for (unsigned long long step = 0; step < steps; step++) {
+        updateSimulation(simulation, 1.0 / simulationHz);
+        simulation.sprinkles.settled.clear();
+        if (step + 1 == steps / 2) run.exitsFirstHalf = getTunnelStats(simulation.sprinkles).exits;
+    }
+    TunnelStats stats = getTunnelStats(simulation.sprinkles);
+    run.exitsSecondHalf = stats.exits - run.exitsFirstHalf;
+    run.maxQueueDepth = stats.maxQueueDepth;
+    return run;
+}
+
+int main() {
+    const double SECONDS = 240.0;
+    const double SIMULATION_HZ = 120.0;
+    // All longer than SPRINKLE_SPAWN_INTERVAL, so the tunnel is always backed up
+    const float intervals[] = { 0.1f, 0.25f, 0.5f };
+    bool failed = false;
+    for (float interval : intervals) {
+        TunnelRun run = runTunnel(interval, SECONDS, SIMULATION_HZ);
+        // The second half starts with a full queue, so it should run at the exit rate throughout
+        double expected = SECONDS * 0.5 / interval;
+        bool ok = run.exitsSecondHalf >= expected * 0.95 && run.exitsSecondHalf <= expected + 1.0 &&
+            run.maxQueueDepth <= DEFAULT_SPRINKLE_CAPACITY;
+        std::cout << (ok ? "ok   " : "FAIL ") << "exit interval " << interval << " s: " << run.exitsFirstHalf
+            << " + " << run.exitsSecondHalf << " exits (expected " << expected << " in the second half), max queue depth "
+            << run.maxQueueDepth << std::endl;
+        if (!ok) failed = true;
+    }
+    return failed ? 1 : 0;
+}
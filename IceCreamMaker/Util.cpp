@@ -4,39 +4,151 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
 
-#define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "AssetPack.h"
+#include "GLState.h"
+
+//Kes prevedenih programa: kljuc je hes izvornog koda oba sejdera i drajvera, pa se zastarjeli
+//unosi nikad ne poklope nego se program ponovo prevede i kes prepise
+static std::string shaderCacheDirectory = "shadercache";
+static const char SHADER_CACHE_MAGIC[8] = { 'I', 'C', 'E', 'S', 'H', 'B', 'N', '1' };
+static int shaderCacheHits = 0;
+static int shaderCacheMisses = 0;
 
 // Autor: Nedeljko Tesanovic
 // Opis: pomocne funkcije za ucitavanje sejdera i tekstura
-unsigned int compileShader(GLenum type, const char* source)
-{
-    //Uzima kod u fajlu na putanji "source", kompajlira ga i vraca sejder tipa "type"
-    //Citanje izvornog koda iz fajla
-    std::string content = "";
-    std::ifstream file(source);
-    std::stringstream ss;
-    if (file.is_open())
+static std::string readShaderSource(const char* source)
+{
+    //Citanje izvornog koda iz fajla na putanji "source"
+    //Kod dolazi iz paketa resursa bez kopiranja, ili se cita sa diska
+    AssetSpan file;
+    std::vector<unsigned char> storage;
+    if (!loadAsset(source, file, storage))
     {
-        ss << file.rdbuf();
-        file.close();
-        std::cout << "Uspjesno procitao fajl sa putanje \"" << source << "\"!" << std::endl;
+        std::cout << "Greska pri citanju fajla sa putanje \"" << source << "\"!\n";
+        return std::string();
     }
-    else {
-        ss << "";
-        std::cout << "Greska pri citanju fajla sa putanje \"" << source << "\"!" << std::endl;
-    }
-    std::string temp = ss.str();
-    const char* sourceCode = temp.c_str(); //Izvorni kod sejdera koji citamo iz fajla na putanji "source"
+    return std::string((const char*)file.data, file.size);
+}
+unsigned int compileShader(GLenum type, const std::string& source)
+{
+    //Kompajlira izvorni kod "source" i vraca sejder tipa "type"
+    const char* sourceCode = source.c_str();
+    GLint sourceLength = (GLint)source.size();
 
     int shader = glCreateShader(type); //Napravimo prazan sejder odredjenog tipa (vertex ili fragment)
+    glShaderSource(shader, 1, &sourceCode, &sourceLength); //Postavi izvorni kod sejdera
+    glCompileShader(shader); //Kompajliraj sejder
+    //Status se ne provjerava ovdje: upit bi cekao da drajver zavrsi kompajliranje, vidi finishShader
+    return shader;
+}
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    //FNV-1a
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+static uint64_t hashString(uint64_t hash, const char* text)
+{
+    //Duzina ulazi u hes da "ab"+"c" i "a"+"bc" ne bi dali isti kljuc
+    size_t length = text ? strlen(text) : 0;
+    hash = hashBytes(hash, &length, sizeof(length));
+    return hashBytes(hash, text, length);
+}
+static std::string shaderCachePath(const std::string& vertexSource, const std::string& fragmentSource)
+{
+    //Prazna putanja znaci da se kes ne koristi
+    if (shaderCacheDirectory.empty() || !GLEW_ARB_get_program_binary) return std::string();
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount == 0) return std::string();
 
+    uint64_t hash = 14695981039346656037ULL;
+    hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+    hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+    hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+    hash = hashString(hash, vertexSource.c_str());
+    hash = hashString(hash, fragmentSource.c_str());
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)hash);
+    return shaderCacheDirectory + name;
+}
+static bool loadProgramBinary(unsigned int program, const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    std::vector<char> data((size_t)file.tellg());
+    file.seekg(0);
+    file.read(data.data(), data.size());
+    uint32_t format;
+    if (!file || data.size() <= sizeof(SHADER_CACHE_MAGIC) + sizeof(format) ||
+        memcmp(data.data(), SHADER_CACHE_MAGIC, sizeof(SHADER_CACHE_MAGIC)) != 0) return false;
+    memcpy(&format, data.data() + sizeof(SHADER_CACHE_MAGIC), sizeof(format));
+    size_t headerSize = sizeof(SHADER_CACHE_MAGIC) + sizeof(format);
+
+    //Drajver odbija binarni zapis drugog drajvera ili verzije, pa tada program ostaje nepovezan
+    glProgramBinary(program, (GLenum)format, data.data() + headerSize, (GLsizei)(data.size() - headerSize));
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    return success != GL_FALSE;
+}
+static void saveProgramBinary(unsigned int program, const std::string& path)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(program, length, NULL, &format, binary.data());
+    uint32_t storedFormat = (uint32_t)format;
+
+#ifdef _WIN32
+    _mkdir(shaderCacheDirectory.c_str());
+#else
+    mkdir(shaderCacheDirectory.c_str(), 0755);
+#endif
+    //Upis ide u privremeni fajl pa se preimenuje, da prekinut upis ne ostavi pola programa u kesu
+    std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary);
+    file.write(SHADER_CACHE_MAGIC, sizeof(SHADER_CACHE_MAGIC));
+    file.write((const char*)&storedFormat, sizeof(storedFormat));
+    file.write(binary.data(), binary.size());
+    file.close();
+    if (!file)
+    {
+        std::remove(temporaryPath.c_str());
+        return;
+    }
+    std::remove(path.c_str());
+    std::rename(temporaryPath.c_str(), path.c_str());
+}
+void setShaderCacheDirectory(const char* directory)
+{
+    shaderCacheDirectory = directory ? directory : "";
+}
+void getShaderCacheStats(int& hits, int& misses)
+{
+    hits = shaderCacheHits;
+    misses = shaderCacheMisses;
+}
+static bool checkShader(unsigned int shader, GLenum type)
+{
     int success; //Da li je kompajliranje bilo uspjesno (1 - da)
     char infoLog[512]; //Poruka o gresci (Objasnjava sta je puklo unutar sejdera)
-    glShaderSource(shader, 1, &sourceCode, NULL); //Postavi izvorni kod sejdera
-    glCompileShader(shader); //Kompajliraj sejder
-
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success); //Provjeri da li je sejder uspjesno kompajliran
     if (success == GL_FALSE)
     {
@@ -48,48 +160,103 @@ unsigned int compileShader(GLenum type, const char* source)
         printf(" sejder ima gresku! Greska: \n");
         printf(infoLog);
     }
-    return shader;
+    return success != GL_FALSE;
 }
-unsigned int createShader(const char* vsSource, const char* fsSource)
+static PendingShader beginShaderFromStrings(const std::string& vertexSource, const std::string& fragmentSource)
 {
-    //Pravi objedinjeni sejder program koji se sastoji od Vertex sejdera ciji je kod na putanji vsSource
-
-    unsigned int program; //Objedinjeni sejder
-    unsigned int vertexShader; //Verteks sejder (za prostorne podatke)
-    unsigned int fragmentShader; //Fragment sejder (za boje, teksture itd)
-
-    program = glCreateProgram(); //Napravi prazan objedinjeni sejder program
+    //Pokrece kompajliranje i povezivanje bez cekanja na rezultat, pa CPU moze raditi nesto drugo
+    //dok drajver (uz KHR_parallel_shader_compile na vise niti) pravi program
+    static bool parallelCompileEnabled = false;
+    if (!parallelCompileEnabled && GLEW_KHR_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); //Drajver sam bira broj niti
+        parallelCompileEnabled = true;
+    }
 
-    vertexShader = compileShader(GL_VERTEX_SHADER, vsSource); //Napravi i kompajliraj vertex sejder
-    fragmentShader = compileShader(GL_FRAGMENT_SHADER, fsSource); //Napravi i kompajliraj fragment sejder
+    PendingShader pending;
+    pending.cachePath = shaderCachePath(vertexSource, fragmentSource);
+    pending.program = glCreateProgram(); //Napravi prazan objedinjeni sejder program
+    if (!pending.cachePath.empty())
+    {
+        if (loadProgramBinary(pending.program, pending.cachePath))
+        {
+            shaderCacheHits++;
+            return pending; //Gotov program, nema sejdera za kompajliranje
+        }
+        //Nema ga u kesu ili je zastario: ispocetka, sa novim programom
+        glDeleteProgram(pending.program);
+        pending.program = glCreateProgram();
+        glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        shaderCacheMisses++;
+    }
+    pending.vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource); //Napravi i kompajliraj vertex sejder
+    pending.fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource); //Napravi i kompajliraj fragment sejder
 
     //Zakaci verteks i fragment sejdere za objedinjeni program
-    glAttachShader(program, vertexShader);
-    glAttachShader(program, fragmentShader);
-
-    glLinkProgram(program); //Povezi ih u jedan objedinjeni sejder program
-    glValidateProgram(program); //Izvrsi provjeru novopecenog programa
+    glAttachShader(pending.program, pending.vertexShader);
+    glAttachShader(pending.program, pending.fragmentShader);
+    glLinkProgram(pending.program); //Povezi ih u jedan objedinjeni sejder program
+    return pending;
+}
+PendingShader beginShader(const char* vsSource, const char* fsSource)
+{
+    //vsSource i fsSource su putanje do fajlova sa kodom
+    return beginShaderFromStrings(readShaderSource(vsSource), readShaderSource(fsSource));
+}
+PendingShader beginShaderFromSource(const char* vertexSource, const char* fragmentSource)
+{
+    return beginShaderFromStrings(vertexSource, fragmentSource);
+}
+bool isShaderReady(const PendingShader& pending)
+{
+    if (!GLEW_KHR_parallel_shader_compile) return true; //Bez ekstenzije nema nacina da se pita, finishShader ce sacekati
+    int done;
+    glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &done);
+    return done != GL_FALSE;
+}
+unsigned int finishShader(PendingShader& pending)
+{
+    //Ceka da program bude gotov, ispisuje greske i vraca 0 ako nije uspio
+    if (pending.vertexShader == 0 && pending.fragmentShader == 0) return pending.program; //Ucitan iz kesa, vec provjeren
+    bool compiled = checkShader(pending.vertexShader, GL_VERTEX_SHADER);
+    compiled = checkShader(pending.fragmentShader, GL_FRAGMENT_SHADER) && compiled;
 
     int success;
     char infoLog[512];
-    glGetProgramiv(program, GL_VALIDATE_STATUS, &success); //Slicno kao za sejdere
+    glGetProgramiv(pending.program, GL_LINK_STATUS, &success); //Slicno kao za sejdere
     if (success == GL_FALSE)
     {
-        glGetShaderInfoLog(program, 512, NULL, infoLog);
+        glGetProgramInfoLog(pending.program, 512, NULL, infoLog);
         std::cout << "Objedinjeni sejder ima gresku! Greska: \n";
         std::cout << infoLog << std::endl;
     }
 
     //Posto su kodovi sejdera u objedinjenom sejderu, oni pojedinacni programi nam ne trebaju, pa ih brisemo zarad ustede na memoriji
-    glDetachShader(program, vertexShader);
-    glDeleteShader(vertexShader);
-    glDetachShader(program, fragmentShader);
-    glDeleteShader(fragmentShader);
+    glDetachShader(pending.program, pending.vertexShader);
+    glDeleteShader(pending.vertexShader);
+    glDetachShader(pending.program, pending.fragmentShader);
+    glDeleteShader(pending.fragmentShader);
+    pending.vertexShader = pending.fragmentShader = 0;
 
-    return program;
+    if (!compiled || success == GL_FALSE)
+    {
+        glDeleteProgram(pending.program);
+        pending.program = 0;
+    }
+    else if (!pending.cachePath.empty())
+    {
+        saveProgramBinary(pending.program, pending.cachePath); //Sljedece pokretanje preskace kompajliranje
+    }
+    return pending.program;
+}
+unsigned int createShader(const char* vsSource, const char* fsSource)
+{
+    //Pravi objedinjeni sejder program koji se sastoji od Vertex sejdera ciji je kod na putanji vsSource
+    PendingShader pending = beginShader(vsSource, fsSource);
+    return finishShader(pending);
 }
 
-unsigned loadImageToTexture(const char* filePath) {
+unsigned loadImageToTexture(const char* filePath, TextureRect* visibleRect) {
     int TextureWidth;
     int TextureHeight;
     int TextureChannels;
@@ -97,7 +264,7 @@ unsigned loadImageToTexture(const char* filePath) {
     if (ImageData != NULL)
     {
         //Slike se osnovno ucitavaju naopako pa se moraju ispraviti da budu uspravne
-        stbi__vertical_flip(ImageData, TextureWidth, TextureHeight, TextureChannels);
+        flipImageRows(ImageData, TextureWidth, TextureHeight, TextureChannels);
 
         // Provjerava koji je format boja ucitane slike
         GLint InternalFormat = -1;
@@ -109,11 +276,26 @@ unsigned loadImageToTexture(const char* filePath) {
         default: InternalFormat = GL_RGB; break;
         }
 
+        // Ako je trazeno, salje se samo vidljivi dio slike (bez providnih ivica)
+        int x0 = 0, y0 = 0, x1 = TextureWidth, y1 = TextureHeight;
+        if (visibleRect != NULL) {
+            findVisibleBounds(ImageData, TextureWidth, TextureHeight, TextureChannels, x0, y0, x1, y1);
+            *visibleRect = boundsToRect(TextureWidth, TextureHeight, x0, y0, x1, y1);
+        }
+
         unsigned int Texture;
         glGenTextures(1, &Texture);
-        glBindTexture(GL_TEXTURE_2D, Texture);
-        glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, TextureWidth, TextureHeight, 0, InternalFormat, GL_UNSIGNED_BYTE, ImageData);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        bindTexture2D(0, Texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, TextureWidth);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, x0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, y0);
+        glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, x1 - x0, y1 - y0, 0, InternalFormat, GL_UNSIGNED_BYTE, ImageData);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        bindTexture2D(0, 0);
         // oslobadjanje memorije zauzete sa stbi_load posto vise nije potrebna
         stbi_image_free(ImageData);
         return Texture;
@@ -158,28 +340,6 @@ GLFWcursor* loadImageToCursor(const char* filePath) {
 // In Util.cpp
 unsigned int createShaderFromSource(const char* vertexSource, const char* fragmentSource) {
     // Similar to createShader but from source strings
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexSource, NULL);
-    glCompileShader(vertexShader);
-
-    // Check compilation...
-    // (add error checking similar to your existing createShader function)
-
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
-    glCompileShader(fragmentShader);
-
-    // Check compilation...
-
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // Check linking...
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    return shaderProgram;
+    PendingShader pending = beginShaderFromSource(vertexSource, fragmentSource);
+    return finishShader(pending);
 }
\ No newline at end of file
@@ -1,8 +1,34 @@
 #pragma once
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <string>
+#include <vector>
+#include "Image.h"
+
+// A program whose compile and link were started but not yet checked
+struct PendingShader {
+    unsigned int program = 0;
+    unsigned int vertexShader = 0;
+    unsigned int fragmentShader = 0;
+    std::string cachePath; // Where the linked binary is stored; empty when not caching
+};
+
 unsigned int createShader(const char* vsSource, const char* fsSource);
-unsigned loadImageToTexture(const char* filePath);
+// createShader() in two halves: begin queues the work with the driver (or loads the program's
+// binary from the shader cache), finish waits for it, reports errors and returns the program
+// (0 on failure)
+PendingShader beginShader(const char* vsSource, const char* fsSource);
+PendingShader beginShaderFromSource(const char* vertexSource, const char* fragmentSource);
+// Whether finishShader() would return without blocking (always true without KHR_parallel_shader_compile)
+bool isShaderReady(const PendingShader& pending);
+unsigned int finishShader(PendingShader& pending);
+// Linked programs are stored under directory (default "shadercache"), keyed by a hash of both
+// sources and the GL vendor, renderer and version; an empty directory turns the cache off
+void setShaderCacheDirectory(const char* directory);
+// Programs loaded from the cache and programs compiled because they were missing or stale
+void getShaderCacheStats(int& hits, int& misses);
+// When visibleRect is given the image is trimmed to its alpha bounding box before upload
+unsigned loadImageToTexture(const char* filePath, TextureRect* visibleRect = NULL);
 GLFWcursor* loadImageToCursor(const char* filePath);
 unsigned int createShaderFromSource(const char* vertexSource, const char* fragmentSource);
 
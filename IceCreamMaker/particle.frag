@@ -1,8 +1,11 @@
 #version 330 core
 in vec2 TexCoord;
+in vec3 Color;
 out vec4 FragColor;
 
-uniform vec3 uColor;
+uniform float uOverdraw; // 1: every fragment adds the same small amount (blended additively)
+
+const vec4 OVERDRAW_STEP = vec4(1.0 / 255.0, 12.0 / 255.0, 40.0 / 255.0, 1.0);
 
 void main() {
     // Create circular particles
@@ -11,5 +14,5 @@ void main() {
     if (dist > 0.5) {
         discard;
     }
-    FragColor = vec4(uColor, 1.0);
+    FragColor = mix(vec4(Color, 1.0), OVERDRAW_STEP, uOverdraw);
 }
\ No newline at end of file
@@ -2,14 +2,30 @@
 layout(location = 0) in vec2 aPos;
 layout(location = 1) in vec2 aTexCoord;
 
-uniform vec2 uPosition;
-uniform float uSize;
+// Per-sprinkle data, advanced once per instance
+layout(location = 2) in vec2 aPosition;
+layout(location = 3) in float aSize;
+layout(location = 4) in float aRotation;
+layout(location = 5) in vec3 aColor;
+
+uniform float uAspect;
+uniform vec4 uView; // Target area in screen space: center xy, half size zw
+uniform float uDepth;
 
 out vec2 TexCoord;
+out vec3 Color;
 
 void main() {
-    vec2 scaledPos = aPos * uSize;
-    vec2 finalPos = scaledPos + uPosition;
-    gl_Position = vec4(finalPos, 0.0, 1.0);
+    // The quad is already squashed by the aspect ratio, so rotate it in square space
+    vec2 squarePos = vec2(aPos.x * uAspect, aPos.y);
+    float c = cos(aRotation);
+    float s = sin(aRotation);
+    vec2 rotatedPos = vec2(c * squarePos.x - s * squarePos.y, s * squarePos.x + c * squarePos.y);
+    rotatedPos.x /= uAspect;
+
+    vec2 scaledPos = rotatedPos * aSize;
+    vec2 finalPos = scaledPos + aPosition;
+    gl_Position = vec4((finalPos - uView.xy) / uView.zw, uDepth, 1.0);
     TexCoord = aTexCoord;
+    Color = aColor;
 }
\ No newline at end of file
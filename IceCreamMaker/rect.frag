@@ -4,7 +4,11 @@ in vec2 chTex;
 out vec4 outCol;
 
 uniform sampler2D uTex;
+uniform float uOverdraw; // 1: every fragment adds the same small amount (blended additively)
+
+const vec4 OVERDRAW_STEP = vec4(1.0 / 255.0, 12.0 / 255.0, 40.0 / 255.0, 1.0);
+
 void main()
 {
-    outCol = texture(uTex, chTex);    
+    outCol = mix(texture(uTex, chTex), OVERDRAW_STEP, uOverdraw);    
 } 
\ No newline at end of file
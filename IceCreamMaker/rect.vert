@@ -1,17 +1,18 @@
 #version 330 core
 
-layout(location = 0) in vec2 inPos;
+layout(location = 0) in vec3 inPos; // z is 0 for buffers that only hold xy
 layout(location = 1) in vec2 inTex;
 out vec2 chTex;
 
 uniform vec2 uTranslation;
 uniform vec2 uScale;
+uniform float uDepth;
 
 void main()
 {
-    vec2 scaledPos = inPos * uScale;
+    vec2 scaledPos = inPos.xy * uScale;
     vec2 translatedPos = scaledPos + uTranslation;
     
-    gl_Position = vec4(translatedPos, 0.0, 1.0);
+    gl_Position = vec4(translatedPos, inPos.z + uDepth, 1.0);
     chTex = inTex;
 }
\ No newline at end of file